@@ -17,15 +17,19 @@ def calculate():
     y_str = y_entry.get()
     xx_str = xx_entry.get()
 
+    # Tryby 8-10 (splajn dwuwymiarowy) przyjmują dwie liczby: węzły w kierunku x i y
     try:
-        nodes = int(nodes_str) + 1
-        if nodes <= 0:
+        counts = [int(v) + 1 for v in nodes_str.split()]
+        if len(counts) != (2 if mode in (8, 9, 10) else 1) or min(counts) <= 0:
             raise ValueError
     except ValueError:
         messagebox.showerror(
-            "Błąd", "Liczba węzłów musi być dodatnią liczbą całkowitą."
+            "Błąd",
+            "Liczba węzłów musi być dodatnią liczbą całkowitą "
+            "(w trybach 8-10 dwie liczby: dla x i dla y).",
         )
         return
+    nodes = counts[0]
 
     x_values = x_str.split()
     y_values = y_str.split()
@@ -39,11 +43,43 @@ def calculate():
                 "Błąd", f"W trybie 1/2 wymagane {required} wartości x i y"
             )
             return
-    elif mode == 3:
+    elif mode == 3 or mode == 4 or mode == 5:
         required = 2 * nodes
         if len(x_values) != required or len(y_values) != required:
             messagebox.showerror(
-                "Błąd", f"W trybie 3 wymagane {required} wartości x i y"
+                "Błąd", f"W trybie {mode} wymagane {required} wartości x i y"
+            )
+            return
+    elif mode == 6:
+        required = nodes
+        if len(x_values) != required or len(y_values) != required:
+            messagebox.showerror(
+                "Błąd", f"W trybie 6 wymagane {required} wartości x i y"
+            )
+            return
+    elif mode == 7:
+        if len(x_values) != nodes:
+            messagebox.showerror(
+                "Błąd", f"W trybie 7 wymagane {nodes} węzłów x"
+            )
+            return
+        if len(y_values) == 0 or len(y_values) % 2 != 0:
+            messagebox.showerror(
+                "Błąd", "W trybie 7 wymagane pary próbek (x y)"
+            )
+            return
+    elif mode in (8, 9, 10):
+        width = 2 if mode == 10 else 1
+        nx, ny = counts
+        if len(x_values) != width * (nx + ny):
+            messagebox.showerror(
+                "Błąd",
+                f"W trybie {mode} wymagane {width * (nx + ny)} wartości węzłów x i y",
+            )
+            return
+        if len(y_values) != width * nx * ny:
+            messagebox.showerror(
+                "Błąd", f"W trybie {mode} wymagane {width * nx * ny} wartości z"
             )
             return
     else:
@@ -56,10 +92,29 @@ def calculate():
             if len(xx_values) != 1:
                 raise ValueError
             xx = [float(xx_values[0])]
-        elif mode == 3:
+        elif mode == 3 or mode == 4:
             if len(xx_values) != 2:
                 raise ValueError
             xx = list(map(float, xx_values))
+        elif mode == 5:
+            # próg względnej szerokości i para przedziałów xx
+            if len(xx_values) != 3:
+                raise ValueError
+            xx = list(map(float, xx_values))
+        elif mode == 6:
+            # lambda (ujemna – wybór przez GCV) i punkt xx
+            if len(xx_values) != 2:
+                raise ValueError
+            xx = list(map(float, xx_values))
+        elif mode == 7:
+            if len(xx_values) != 1:
+                raise ValueError
+            xx = [float(xx_values[0])]
+        else:
+            # punkt (xx, yy)
+            if len(xx_values) != 2 * width:
+                raise ValueError
+            xx = list(map(float, xx_values))
     except ValueError:
         messagebox.showerror(
             "Błąd", "Nieprawidłowy format punktu xx dla wybranego trybu"
@@ -68,9 +123,23 @@ def calculate():
 
     # Zapisz dane do pliku
     with open("input.txt", "w") as f:
-        f.write(f"{mode}\n{nodes}\n")
-        f.write(" ".join(x_values) + "\n")
-        f.write(" ".join(y_values) + "\n")
+        if mode == 7:
+            # węzły, liczba próbek, próbki x, próbki y
+            f.write(f"{mode}\n{nodes}\n")
+            f.write(" ".join(x_values) + "\n")
+            f.write(f"{len(y_values) // 2}\n")
+            f.write(" ".join(y_values[0::2]) + "\n")
+            f.write(" ".join(y_values[1::2]) + "\n")
+        elif mode in (8, 9, 10):
+            # nx, ny, węzły x, węzły y, wartości z
+            f.write(f"{mode}\n{nx} {ny}\n")
+            f.write(" ".join(x_values[: width * nx]) + "\n")
+            f.write(" ".join(x_values[width * nx :]) + "\n")
+            f.write(" ".join(y_values) + "\n")
+        else:
+            f.write(f"{mode}\n{nodes}\n")
+            f.write(" ".join(x_values) + "\n")
+            f.write(" ".join(y_values) + "\n")
         f.write(" ".join(map(str, xx)) + "\n")
 
     # Uruchom obliczenia
@@ -116,6 +185,35 @@ def show_info():
     - y: pary przedziałów (np. 1.9 2.1 2.9 3.1)
     - xx: para przedziałów (np. 2.4 2.6)
     - Wynik: Wartość przedziałowa
+
+    Tryb 4 (Przedziały dane przedziałowe, arytmetyka afiniczna):
+    - format danych jak w trybie 3
+    - Wynik: Wartość przedziałowa (węższa przy wielu węzłach)
+
+    Tryb 5 (Przedziały dane przedziałowe, precyzja adaptacyjna):
+    - x, y: jak w trybie 3
+    - xx: próg względnej szerokości współczynników i para przedziałów
+      (np. 1e-10 2.4 2.6)
+    - Wynik: Wartość przedziałowa i użyta precyzja (double, float128
+      lub mpreal)
+
+    Tryb 6 (Splajn wygładzający):
+    - x, y: jak w trybie 1
+    - xx: lambda i punkt (np. 0.1 2.5); lambda ujemna – wybór przez GCV
+    - Wynik: Wartość zmiennoprzecinkowa i użyta lambda
+
+    Tryb 7 (Splajn regresyjny):
+    - x: węzły splajnu (np. 1 2 3)
+    - y: pary próbek x y (np. 1.1 2.0 1.7 2.6 2.8 4.9)
+    - xx: pojedyncza wartość (np. 2.5)
+    - Wynik: Wartość zmiennoprzecinkowa
+
+    Tryby 8-10 (Splajn dwuwymiarowy, dane jak w trybach 1, 2 i 3):
+    - Liczba węzłów: dwie liczby, dla x i dla y (np. 2 1)
+    - x: węzły x, a po nich węzły y (w trybie 10 pary granic)
+    - y: wartości z wierszami dla kolejnych węzłów x (z[i*ny + j])
+    - xx: punkt xx yy (w trybie 10 dwie pary granic)
+    - Wynik: Wartość zmiennoprzecinkowa (8) lub przedziałowa (9, 10)
     """
     messagebox.showinfo("Instrukcja", info)
 
@@ -162,12 +260,20 @@ modes = [
     ("Tryb 1 - Standardowy", 1),
     ("Tryb 2 - Przedziały dane rzeczywiste", 2),
     ("Tryb 3 - Przedziały dane przedziałowe", 3),
+    ("Tryb 4 - Przedziały (afiniczna)", 4),
+    ("Tryb 5 - Przedziały (adaptacyjna)", 5),
+    ("Tryb 6 - Wygładzający", 6),
+    ("Tryb 7 - Regresyjny", 7),
+    ("Tryb 8 - 2D standardowy", 8),
+    ("Tryb 9 - 2D dane rzeczywiste", 9),
+    ("Tryb 10 - 2D dane przedziałowe", 10),
 ]
 
+# Trzy tryby w wierszu – w jednym rzędzie przyciski nie mieszczą się w oknie
 for text, val in modes:
     ttk.Radiobutton(
         mode_frame, text=text, variable=mode_var, value=val, style="Toolbutton"
-    ).pack(side="left", padx=10, pady=5)
+    ).grid(row=(val - 1) // 3, column=(val - 1) % 3, sticky="w", padx=10, pady=5)
 
 # Panel danych wejściowych
 input_frame = ttk.LabelFrame(root, text=" Dane wejściowe ", padding=15)
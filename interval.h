@@ -23,6 +23,11 @@
  #include <fstream>
  #include <float.h>
  #include <typeinfo>
+ #include <vector>
+ #include <new>
+ #include <type_traits>
+ #include <limits>
+ #include <algorithm>
  #include "mpreal.h"
  
  using namespace std;
@@ -31,11 +36,12 @@
  namespace interval_arithmetic {
  
  enum IAPrecision {
-     LONGDOUBLE_PREC = 63, DOUBLE_PREC = 53, FLOAT_PREC = 32, MPREAL_PREC = 128
+     LONGDOUBLE_PREC = 63, DOUBLE_PREC = 53, FLOAT_PREC = 32, MPREAL_PREC = 128,
+     FLOAT128_PREC = 113
  };
  
  enum IAOutDigits {
-     LONGDOUBLE_DIGITS = 17, DOUBLE_DIGITS = 16, FLOAT_DIGITS = 7
+     LONGDOUBLE_DIGITS = 17, DOUBLE_DIGITS = 16, FLOAT_DIGITS = 7, FLOAT128_DIGITS = 34
  };
  
  enum IAMode {
@@ -45,6 +51,8 @@
  template<typename T> class Interval;
  
  template<typename T> Interval<T> IntRead(const string &sa);
+ template<typename T> const char *IntReadNext(const char *text, Interval<T> &r);
+ template<typename T> size_t IntReadAll(const char *text, std::vector<Interval<T> > &out);
  template<typename T> Interval<T> ParseInterval(const string &sa);
  template<typename T> T LeftRead(const string &sa);
  template<typename T> T RightRead(const string &sa);
@@ -61,6 +69,7 @@
  template<typename T> Interval<T> ISin(const Interval<T> &x);
  template<typename T> Interval<T> ICos(const Interval<T> &x);
  template<typename T> Interval<T> IExp(const Interval<T> &x);
+ template<typename T> Interval<T> ILog(const Interval<T> &x, int &st);
  
  template<typename T> Interval<T> DIAdd(const Interval<T> &x,
          const Interval<T> &y);
@@ -79,14 +88,17 @@
  
  template<typename T> int SetRounding(int rounding);
  template<> Interval<mpreal> IntRead(const string &sa);
+ template<typename T> struct IAContext;
  
  template<typename T> class Interval {
  private:
-     static IAPrecision precision;
-     static IAOutDigits outdigits;
+     // Ustawienia są osobne dla każdego wątku (zob. IAContext), tak samo jak tryb
+     // zaokrąglania FPU i domyślne precyzja/zaokrąglanie MPFR
+     static thread_local IAPrecision precision;
+     static thread_local IAOutDigits outdigits;
  
  public:
-     static IAMode mode;
+     static thread_local IAMode mode;
      T a;
      T b;
      Interval();
@@ -132,6 +144,7 @@
      friend Interval ICos<T>(const Interval<T> &x);
      friend Interval IExp<T>(const Interval<T> &x);
      friend Interval IntRead<T>(const string &sa);
+     friend const char *IntReadNext<T>(const char *text, Interval &r);
      friend T LeftRead<T>(const string &sa);
      friend T RightRead<T>(const string &sa);
  
@@ -147,6 +160,7 @@
      friend Interval Hull<T>(const Interval &x, const Interval &y);
  
      friend int SetRounding<T>(int rounding);
+     friend struct IAContext<T>;
  };
  
  template<typename T>
@@ -176,24 +190,259 @@
      return Interval<T>::mode;
  }
  
- //template<>
- //inline int SetRounding<mpreal>(int rounding) {
- //	if (rounding == FE_UPWARD) {
- //		mpreal::set_default_rnd(MPFR_RNDU);
- //	} else if (rounding == FE_DOWNWARD) {
- //		mpreal::set_default_rnd(MPFR_RNDD);
- //	} else {
- //		mpreal::set_default_rnd(MPFR_RNDN);
- //	}
- //	return rounding;
- //}
- 
  template<typename T>
  int SetRounding(int rounding) {
      fesetround(rounding);
      return rounding;
  }
  
+ // fesetround nie wpływa na działania MPFR – dla mpreal kierunek zaokrąglenia
+ // ustawiamy jako domyślny tryb mpreal, inaczej Interval<mpreal> nie zaokrągla na zewnątrz
+ template<>
+ inline int SetRounding<mpreal>(int rounding) {
+     if (rounding == FE_UPWARD) {
+         mpreal::set_default_rnd(MPFR_RNDU);
+     } else if (rounding == FE_DOWNWARD) {
+         mpreal::set_default_rnd(MPFR_RNDD);
+     } else {
+         mpreal::set_default_rnd(MPFR_RNDN);
+     }
+     return rounding;
+ }
+ 
+ template<typename T>
+ inline int GetRounding() {
+     return fegetround();
+ }
+ 
+ template<>
+ inline int GetRounding<mpreal>() {
+     mp_rnd_t rnd = mpreal::get_default_rnd();
+     return rnd == MPFR_RNDU ? FE_UPWARD : (rnd == MPFR_RNDD ? FE_DOWNWARD : FE_TONEAREST);
+ }
+ 
+ // Zakres ze stałym kierunkiem zaokrąglenia: konstruktor ustawia tryb, destruktor przywraca
+ // poprzedni (także przy wyjątku). Wewnątrz zakresu można używać działań *Scoped, które nie
+ // zmieniają trybu – pętla po tablicy kosztuje wtedy dwie zmiany trybu zamiast trzech na
+ // każde działanie. Bariery nie pozwalają przenieść przez granice zakresu działań na danych
+ // w pamięci (wartości trzymane tylko w rejestrach trzeba chronić osobno, np. RoundBarrier).
+ template<typename T>
+ class RoundingScope {
+ private:
+     int previous;
+ 
+ public:
+     explicit RoundingScope(int rounding) :
+             previous(GetRounding<T>()) {
+         SetRounding<T>(rounding);
+ #if defined(__GNUC__)
+         __asm__ volatile("" : : : "memory");
+ #endif
+     }
+     ~RoundingScope() {
+ #if defined(__GNUC__)
+         __asm__ volatile("" : : : "memory");
+ #endif
+         SetRounding<T>(previous);
+     }
+     RoundingScope(const RoundingScope &) = delete;
+     RoundingScope &operator=(const RoundingScope &) = delete;
+ };
+ 
+ // Komplet ustawień Interval<T> jednego wątku: tryb (PINT/DINT), precyzja, liczba cyfr
+ // wyniku i kierunek zaokrąglania. Nowy wątek startuje z wartościami domyślnymi, więc pula
+ // wątków powinna pobrać Current() w wątku zlecającym i wywołać Install() w każdym
+ // pracowniku (albo użyć ContextScope). Wątki o różnych ustawieniach nie wpływają na siebie.
+ template<typename T>
+ struct IAContext {
+     IAMode mode;
+     IAPrecision precision;
+     IAOutDigits outdigits;
+     int rounding;
+ 
+     static IAContext Current() {
+         IAContext c;
+         c.mode = Interval<T>::mode;
+         c.precision = Interval<T>::precision;
+         c.outdigits = Interval<T>::outdigits;
+         c.rounding = GetRounding<T>();
+         return c;
+     }
+ 
+     void Install() const {
+         Interval<T>::mode = mode;
+         // dla T = mpreal SetPrecision ustawia też domyślną precyzję mpreal bieżącego wątku
+         Interval<T>::SetPrecision(precision);
+         Interval<T>::outdigits = outdigits;
+         SetRounding<T>(rounding);
+     }
+ };
+ 
+ // Zakres z ustawieniami context w bieżącym wątku; destruktor przywraca poprzednie
+ template<typename T>
+ class ContextScope {
+ private:
+     IAContext<T> previous;
+ 
+ public:
+     explicit ContextScope(const IAContext<T> &context) :
+             previous(IAContext<T>::Current()) {
+         context.Install();
+     }
+     ~ContextScope() {
+         previous.Install();
+     }
+     ContextScope(const ContextScope &) = delete;
+     ContextScope &operator=(const ContextScope &) = delete;
+ };
+ 
+ // Pula bloków pamięci dla GMP/MPFR (limby mpfr_t i mpreal).
+ // Każdy wątek trzyma listy wolnych bloków o dokładnych rozmiarach (od sizeof(void*)
+ // do MAX_POOLED bajtów), więc w stanie ustalonym tymczasowe mpreal/mpfr_t oraz bufory
+ // pomocnicze MPFR (mpfr_set_str, mpfr_sprintf) nie wołają malloc/free.
+ // Bloki z puli są zwykłymi blokami malloc, dlatego bezpiecznie obsługujemy też bloki
+ // przydzielone przed Install() oraz zwalniane przez inny wątek niż ten, który je przydzielił.
+ class MpfrLimbPool {
+ public:
+     // Instalacja funkcji pamięci GMP – najlepiej na początku main(), przed użyciem MPFR
+     static void Install() {
+         mp_set_memory_functions(&Allocate, &Reallocate, &Free);
+     }
+ 
+ private:
+     static const size_t MAX_POOLED = 1024;
+     static const size_t CLASSES = MAX_POOLED + 1;
+ 
+     // Trywialne zmienne wątkowe pozostają dostępne aż do końca wątku, także po
+     // zniszczeniu Guard – zwolnienia po tym momencie trafiają bezpośrednio do free()
+     static void **Heads() {
+         static thread_local void *heads[CLASSES];
+         return heads;
+     }
+     static bool &Closed() {
+         static thread_local bool closed = false;
+         return closed;
+     }
+     struct Guard {
+         ~Guard() {
+             void **heads = Heads();
+             for (size_t c = 0; c < CLASSES; c++) {
+                 while (heads[c] != NULL) {
+                     void *next = *static_cast<void **>(heads[c]);
+                     free(heads[c]);
+                     heads[c] = next;
+                 }
+             }
+             Closed() = true;
+         }
+     };
+     static bool Pooled(size_t size) {
+         if (size < sizeof(void *) || size > MAX_POOLED || Closed())
+             return false;
+         static thread_local Guard guard;
+         (void) guard;
+         return true;
+     }
+ 
+     static void *Allocate(size_t size) {
+         if (Pooled(size)) {
+             void **head = &Heads()[size];
+             if (*head != NULL) {
+                 void *p = *head;
+                 *head = *static_cast<void **>(p);
+                 return p;
+             }
+         }
+         void *p = malloc(size);
+         if (p == NULL)
+             throw std::bad_alloc();
+         return p;
+     }
+ 
+     static void Free(void *p, size_t size) {
+         if (p == NULL)
+             return;
+         if (Pooled(size)) {
+             void **head = &Heads()[size];
+             *static_cast<void **>(p) = *head;
+             *head = p;
+         } else {
+             free(p);
+         }
+     }
+ 
+     static void *Reallocate(void *p, size_t oldSize, size_t newSize) {
+         if (!Pooled(oldSize) && !Pooled(newSize)) {
+             void *q = realloc(p, newSize);
+             if (q == NULL)
+                 throw std::bad_alloc();
+             return q;
+         }
+         void *q = Allocate(newSize);
+         memcpy(q, p, oldSize < newSize ? oldSize : newSize);
+         Free(p, oldSize);
+         return q;
+     }
+ };
+ 
+ // Wielokrotnie używane zmienne MPFR do parsowania i wypisywania (po jednym zestawie
+ // na wątek) – zastępują pary mpfr_init2/mpfr_clear przy każdej wczytanej wartości
+ class MpfrScratch {
+ public:
+     static const int SLOTS = 2;
+ 
+     // Zmienna nr slot o precyzji prec; przydział limbów następuje tylko przy wzroście precyzji
+     static mpfr_ptr Get(int slot, mpfr_prec_t prec) {
+         mpfr_ptr v = Local().vars[slot];
+         if (mpfr_get_prec(v) != prec)
+             mpfr_set_prec(v, prec);
+         return v;
+     }
+ 
+     // Bufor znakowy na wynik mpfr_get_str/mpfr_sprintf
+     static char *Buffer(size_t size) {
+         std::vector<char> &buf = Local().buffer;
+         if (buf.size() < size)
+             buf.resize(size);
+         return buf.data();
+     }
+ 
+ private:
+     mpfr_t vars[SLOTS];
+     std::vector<char> buffer;
+ 
+     MpfrScratch() {
+         for (int i = 0; i < SLOTS; i++)
+             mpfr_init2(vars[i], 113);
+     }
+     ~MpfrScratch() {
+         for (int i = 0; i < SLOTS; i++)
+             mpfr_clear(vars[i]);
+     }
+     static MpfrScratch &Local() {
+         static thread_local MpfrScratch scratch;
+         return scratch;
+     }
+ };
+ 
+ // Konwersja wartości MPFR do __float128 z zadanym kierunkiem zaokrąglenia.
+ // mpfr_get_ld daje tylko 64 bity mantysy, więc bierzemy część long double i resztę
+ // (różnica jest dokładna w precyzji x), a sumę zaokrąglamy w tym samym kierunku.
+ inline __float128 MpfrGetFloat128(mpfr_srcptr x, mpfr_rnd_t rnd) {
+     long double hi = mpfr_get_ld(x, MPFR_RNDN);
+     if (!std::isfinite(hi) || mpfr_get_prec(x) <= 64)
+         return mpfr_get_ld(x, rnd);
+     mpfr_ptr rest = MpfrScratch::Get(1, mpfr_get_prec(x));
+     mpfr_set_ld(rest, hi, MPFR_RNDN);
+     mpfr_sub(rest, x, rest, MPFR_RNDN);
+     long double lo = mpfr_get_ld(rest, rnd);
+     int old = fegetround();
+     fesetround(rnd == MPFR_RNDU ? FE_UPWARD : (rnd == MPFR_RNDD ? FE_DOWNWARD : FE_TONEAREST));
+     __float128 r = (__float128) hi + (__float128) lo;
+     fesetround(old);
+     return r;
+ }
+ 
  template<typename T>
  inline Interval<T>& Interval<T>::operator =(Interval<T> i) {
      std::swap(this->a, i.a);
@@ -203,7 +452,9 @@
  
  template<typename T>
  inline void Interval<T>::SetPrecision(IAPrecision p) {
-     mpreal::set_default_prec(p);
+     // domyślną precyzję mpreal (też thread_local) zmienia tylko Interval<mpreal>
+     if constexpr (std::is_same<T, mpreal>::value)
+         mpreal::set_default_prec(p);
      Interval<T>::precision = p;
  }
  
@@ -227,58 +478,99 @@
      return std::numeric_limits<T>::epsilon();
  }
  
+ // Pobranie wartości MPFR jako T z zadanym zaokrągleniem – wybór funkcji w czasie kompilacji
  template<typename T>
- inline Interval<T> IntRead(const string &sa) {
-     Interval<T> r;
-     mpfr_t rop;
-     mpfr_init2(rop, Interval<T>::precision);
-     mpfr_set_str(rop, sa.c_str(), 10, MPFR_RNDD);
-     T le = 0.0;
-     if (strcmp(typeid(T).name(), typeid(long double).name()) == 0) {
-         le = mpfr_get_ld(rop, MPFR_RNDD);
-     }
-     if (strcmp(typeid(T).name(), typeid(double).name()) == 0) {
-         le = mpfr_get_d(rop, MPFR_RNDD);
-     }
-     if (strcmp(typeid(T).name(), typeid(float).name()) == 0) {
-         le = mpfr_get_flt(rop, MPFR_RNDD);
-     }
+ inline T MpfrGet(mpfr_srcptr x, mpfr_rnd_t rnd) {
+     if constexpr (std::is_same<T, float>::value)
+         return mpfr_get_flt(x, rnd);
+     else if constexpr (std::is_same<T, double>::value)
+         return mpfr_get_d(x, rnd);
+     else if constexpr (std::is_same<T, long double>::value)
+         return mpfr_get_ld(x, rnd);
+     else if constexpr (std::is_same<T, __float128>::value)
+         return MpfrGetFloat128(x, rnd);
+     else
+         static_assert(sizeof(T) == 0, "MpfrGet: nieobsługiwany typ");
+ }
  
-     mpfr_set_str(rop, sa.c_str(), 10, MPFR_RNDU);
-     T re = 0.0;
-     if (strcmp(typeid(T).name(), typeid(long double).name()) == 0) {
-         re = mpfr_get_ld(rop, MPFR_RNDU);
-     }
-     if (strcmp(typeid(T).name(), typeid(double).name()) == 0) {
-         re = mpfr_get_d(rop, MPFR_RNDU);
-     }
-     if (strcmp(typeid(T).name(), typeid(float).name()) == 0) {
-         re = mpfr_get_flt(rop, MPFR_RNDU);
+ // Wczytanie jednej liczby dziesiętnej z text do r z zaokrągleniem na zewnątrz.
+ // Napis jest parsowany raz (w dół); gdy wynik jest niedokładny, górny koniec to
+ // następna liczba w tej samej precyzji, czyli dokładnie wynik parsowania w górę.
+ // Zwraca wskaźnik za wczytaną liczbą (równy text, gdy nie było liczby).
+ template<typename T>
+ inline const char *IntReadNext(const char *text, Interval<T> &r) {
+     mpfr_ptr rop = MpfrScratch::Get(0, Interval<T>::precision);
+     char *end;
+     int inexact = mpfr_strtofr(rop, text, &end, 10, MPFR_RNDD);
+     if (end == text)
+         return text;
+     if constexpr (std::is_same<T, mpreal>::value) {
+         if (r.a.get_prec() != Interval<T>::precision)
+             r.a.set_prec(Interval<T>::precision);
+         if (r.b.get_prec() != Interval<T>::precision)
+             r.b.set_prec(Interval<T>::precision);
+         mpfr_set(r.a.mpfr_ptr(), rop, MPFR_RNDD);
+         if (inexact != 0)
+             mpfr_nextabove(rop);
+         mpfr_set(r.b.mpfr_ptr(), rop, MPFR_RNDU);
+     } else {
+         r.a = MpfrGet<T>(rop, MPFR_RNDD);
+         if (inexact != 0)
+             mpfr_nextabove(rop);
+         r.b = MpfrGet<T>(rop, MPFR_RNDU);
      }
+     return end;
+ }
  
+ template<typename T>
+ inline Interval<T> IntRead(const string &sa) {
+     Interval<T> r;
+     IntReadNext<T>(sa.c_str(), r);
      SetRounding<T>(FE_TONEAREST);
- 
-     r.a = le;
-     r.b = re;
      return r;
  }
  
  template<>
  inline Interval<mpreal> IntRead(const string &sa) {
      Interval<mpreal> r;
-     mpfr_t rop;
-     mpfr_init2(rop, Interval<mpreal>::precision);
-     mpfr_set_str(rop, sa.c_str(), 10, MPFR_RNDD);
-     mpreal le = rop;
+     IntReadNext<mpreal>(sa.c_str(), r);
+     return r;
+ }
  
-     mpfr_set_str(rop, sa.c_str(), 10, MPFR_RNDU);
-     mpreal re = rop;
+ inline bool IsReadSeparator(char c) {
+     return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+ }
  
-     r.a = le;
-     r.b = re;
-     return r;
+ // Wczytanie wszystkich liczb rozdzielonych białymi znakami z bufora tekstu
+ // (np. całej zawartości pliku) – jeden kontekst MPFR, bez napisów pośrednich.
+ // Każdy token jest kopiowany do bufora roboczego, bo mpfr_strtofr przegląda
+ // resztę napisu i na całym pliku czas rósłby kwadratowo.
+ template<typename T>
+ inline size_t IntReadAll(const char *text, std::vector<Interval<T> > &out) {
+     size_t count = 0;
+     Interval<T> r;
+     for (;;) {
+         while (IsReadSeparator(*text))
+             text++;
+         const char *stop = text;
+         while (*stop != '\0' && !IsReadSeparator(*stop))
+             stop++;
+         size_t len = stop - text;
+         if (len == 0)
+             break;
+         char *token = MpfrScratch::Buffer(len + 1);
+         memcpy(token, text, len);
+         token[len] = '\0';
+         if (IntReadNext<T>(token, r) == token)
+             break;
+         out.push_back(r);
+         text = stop;
+         count++;
+     }
+     SetRounding<T>(FE_TONEAREST);
+     return count;
  }
-
+ 
  template<typename T>
  inline Interval<T> ParseInterval(const std::string& sa) {
      // Sprawdź, czy ciąg zaczyna się od '[' i kończy na ']'
@@ -348,38 +640,32 @@
      return r;
  }
  
- template<typename T>
- inline void Interval<T>::IEndsToStrings(string &left, string &right) {
-     mpfr_t rop;
+ // Zapis końca przedziału w postaci d.dddE[wykładnik] do istniejącego napisu
+ // (bufor cyfr i napis wynikowy są używane ponownie, bez nowych przydziałów)
+ inline void FormatMpfrEnd(string &out, mpfr_srcptr v, mpfr_rnd_t rnd, size_t digits) {
      mpfr_exp_t exponent;
-     mpfr_init2(rop, precision);
-     char *str = NULL;
-     char *buffer = new char(precision + 3);
-     mpfr_set_ld(rop, this->a, MPFR_RNDD);
- 
-     mpfr_get_str(buffer, &exponent, 10, outdigits, rop, MPFR_RNDD);
-     str = buffer;
- 
-     stringstream ss;
-     int prec = std::numeric_limits<T>::digits10;
-     ss.setf(std::ios_base::scientific);
+     char *str = MpfrScratch::Buffer(digits + 3);
+     mpfr_get_str(str, &exponent, 10, digits, v, rnd);
      bool minus = (str[0] == '-');
      int splitpoint = minus ? 1 : 0;
-     string sign = minus ? "-" : "";
- 
-     ss << std::setprecision(prec) << sign << str[splitpoint] << "."
-             << &str[splitpoint + 1] << "E" << exponent - 1;
-     left = ss.str();
-     ss.str(std::string());
+     char expbuf[32];
+     snprintf(expbuf, sizeof(expbuf), "E%ld", (long) (exponent - 1));
+     out.clear();
+     if (minus)
+         out += '-';
+     out += str[splitpoint];
+     out += '.';
+     out += &str[splitpoint + 1];
+     out += expbuf;
+ }
  
+ template<typename T>
+ inline void Interval<T>::IEndsToStrings(string &left, string &right) {
+     mpfr_ptr rop = MpfrScratch::Get(0, precision);
+     mpfr_set_ld(rop, this->a, MPFR_RNDD);
+     FormatMpfrEnd(left, rop, MPFR_RNDD, outdigits);
      mpfr_set_ld(rop, this->b, MPFR_RNDU);
-     mpfr_get_str(buffer, &exponent, 10, outdigits, rop, MPFR_RNDU);
-     str = buffer;
-     splitpoint = (str[0] == '-') ? 1 : 0;
-     ss << std::setprecision(prec) << sign << str[splitpoint] << "."
-             << &str[splitpoint + 1] << "E" << exponent - 1;
-     right = ss.str();
-     ss.clear();
+     FormatMpfrEnd(right, rop, MPFR_RNDU, outdigits);
  }
  
  template<typename T>
@@ -490,26 +776,22 @@
  
  template<typename T>
  inline void Interval<T>::Initialize() {
-     if (strcmp(typeid(T).name(), typeid(long double).name()) == 0) {
+     if constexpr (std::is_same<T, long double>::value) {
          Interval<T>::SetPrecision(LONGDOUBLE_PREC);
          Interval<T>::SetOutDigits(LONGDOUBLE_DIGITS);
-     }
- 
-     if (strcmp(typeid(T).name(), typeid(double).name()) == 0) {
+     } else if constexpr (std::is_same<T, double>::value) {
          Interval<T>::SetPrecision(DOUBLE_PREC);
          Interval<T>::SetOutDigits(DOUBLE_DIGITS);
-     }
- 
-     if (strcmp(typeid(T).name(), typeid(float).name()) == 0) {
+     } else if constexpr (std::is_same<T, float>::value) {
          Interval<T>::SetPrecision(FLOAT_PREC);
          Interval<T>::SetOutDigits(FLOAT_DIGITS);
-     }
- 
-     if (strcmp(typeid(T).name(), typeid(mpreal).name()) == 0) {
+     } else if constexpr (std::is_same<T, mpreal>::value) {
          Interval<T>::SetPrecision(MPREAL_PREC);
          Interval<T>::SetOutDigits(FLOAT_DIGITS);
+     } else if constexpr (std::is_same<T, __float128>::value) {
+         Interval<T>::SetPrecision(FLOAT128_PREC);
+         Interval<T>::SetOutDigits(FLOAT128_DIGITS);
      }
- 
  }
  
  template<typename T>
@@ -546,225 +828,796 @@
          return w2;
  }
  
+ // ------------------------------------------------------------------------------------
+ // Funkcje elementarne sin, cos, exp, log i sqrt.
+ // Dla float, double i long double argument jest redukowany (Cody-Waite, stała podzielona
+ // na trzy części), a na zredukowanym przedziale liczony jest wielomian Taylora stałego
+ // stopnia z oszacowaniem reszty Lagrange'a. Całe obliczenie działa w trybie FE_UPWARD –
+ // jedno przełączenie na wywołanie (lub na całą paczkę w wersjach *Batch), a dolne końce
+ // liczone są jako -((-x) w górę). mpreal, __float128 oraz argumenty trygonometryczne
+ // o bardzo dużym module liczone są przez MPFR z zaokrągleniem RNDD/RNDU.
+ 
+ enum ElementaryKind {
+     ELEM_SIN = 0, ELEM_COS = 1, ELEM_EXP, ELEM_LOG, ELEM_SQRT
+ };
+ 
  template<typename T>
- Interval<T> ISin(const Interval<T> &x) {
-     bool is_even, finished;
-     int k;
-     int st = 0;
-     Interval<T> d, s, w, w1, x2, tmp;
-     Interval<T> izero(0, 0);
-     string left, right;
-     T eps = 1E-18; //Interval<T>::GetEpsilon();
-     T diff = std::numeric_limits<T>::max();
-     if (x.a > x.b)
-         st = 1;
-     else {
-         s = x;
-         w = x;
-         x2 = IMul(x, x);
-         k = 1;
-         is_even = true;
-         finished = false;
-         st = 0;
+ struct FastElementaryType: std::integral_constant<bool,
+         std::is_same<T, float>::value || std::is_same<T, double>::value
+                 || std::is_same<T, long double>::value> {
+ };
  
-         do {
-             d.a = (k + 1) * (k + 2);
-             d.b = d.a;
-             s = IMul(s, IDiv(x2, d));
-             if (is_even)
-                 w1 = ISub(w, s);
-             else
-                 w1 = IAdd(w, s);
+ // Typ, w którym liczone są wielomiany – float liczymy w double i zaokrąglamy na zewnątrz
+ template<typename T> struct ElementaryWork {
+     typedef T type;
+ };
+ template<> struct ElementaryWork<float> {
+     typedef double type;
+ };
  
- //			T oldMid = (w.a + w.b) / 2;
- //			T newMid = (w1.a + w1.b) / 2;
- //			T currDiff = abs(oldMid - newMid);
- //			finished = (currDiff > diff);
- //			diff = currDiff;
+ // Bariera optymalizacji: kompilator nie zna wartości wyniku, więc nie skraca podwójnych
+ // negacji (bez -frounding-math wolno mu to zrobić, a to odwraca kierunek zaokrąglenia)
+ template<typename T>
+ inline T RoundBarrier(T x) {
+ #if defined(__GNUC__) && defined(__SSE2_MATH__)
+     if constexpr (std::is_same<T, double>::value || std::is_same<T, float>::value)
+         __asm__ volatile("" : "+x"(x));
+     else if constexpr (std::is_same<T, long double>::value)
+         __asm__ volatile("" : "+t"(x));
+     else
+         __asm__ volatile("" : "+m"(x));
+ #elif defined(__GNUC__)
+     __asm__ volatile("" : "+m"(x));
+ #endif
+     return x;
+ }
  
-             if ((w.a == 0) && (w.b == 0)) {
-                 return izero;
-             }
+ // Działania zaokrąglane w dół przy ustawionym FE_UPWARD
+ template<typename T>
+ inline T AddDown(T a, T b) {
+     return -RoundBarrier(RoundBarrier(-a) - b);
+ }
  
-             if ((w.a != 0) && (w.b != 0)) {
-                 if ((abs(w.a - w1.a) / abs(w.a) < eps)
-                         && (abs(w.b - w1.b) / abs(w.b) < eps))
-                     finished = true;
-                 else
-                     ;
-             } else if ((w.a == 0) && (w.b != 0)) {
-                 if ((abs(w.a - w1.a) < eps)
-                         && (abs(w.b - w1.b) / abs(w.b) < eps))
-                     finished = true;
-                 else
-                     ;
-             } else if (w.a != 0) {
-                 if ((abs(w.a - w1.a) / abs(w.a) < eps)
-                         & (abs(w.b - w1.b) < eps))
-                     finished = true;
-                 else if ((abs(w.a - w1.a) < eps) & (abs(w.b - w1.b) < eps))
-                     finished = true;
-             }
+ template<typename T>
+ inline T SubDown(T a, T b) {
+     return -RoundBarrier(RoundBarrier(-a) + b);
+ }
  
-             if (finished) {
-                 if (w1.b > 1) {
-                     w1.b = 1;
-                     if (w1.a > 1)
-                         w1.a = 1;
-                 }
-                 if (w1.a < -1) {
-                     w1.a = -1;
-                     if (w1.b < -1)
-                         w1.b = -1;
-                 }
-                 return w1;
-             } else {
-                 w = w1;
-                 k = k + 2;
-                 is_even = !is_even;
-             }
-         } while (!(finished || (k > INT_MAX / 2)));
+ template<typename T>
+ inline T MulDown(T a, T b) {
+     return -RoundBarrier(RoundBarrier(-a) * b);
+ }
+ 
+ template<typename T>
+ inline T DivDown(T a, T b) {
+     return -RoundBarrier(RoundBarrier(-a) / b);
+ }
+ 
+ template<typename T, typename W>
+ inline T NarrowDown(W x) {
+     if constexpr (std::is_same<T, W>::value)
+         return x;
+     else
+         return -RoundBarrier((T) RoundBarrier(-x));
+ }
+ 
+ template<typename T, typename W>
+ inline T NarrowUp(W x) {
+     return (T) x;
+ }
+ 
+ // Stałe funkcji elementarnych w typie W, wyznaczone raz przez MPFR z zaokrągleniem
+ // na zewnątrz. pi/2 i ln 2 są podzielone na część wysoką i środkową (po digits-20 bitów,
+ // więc k*część jest dokładne dla |k| < 2^20) oraz przedział na resztę.
+ template<typename W>
+ struct ElementaryConstants {
+     static const int DIGITS = std::numeric_limits<W>::digits;
+     // Stopnie wielomianów dobrane tak, by reszta była poniżej 0.1 ulp
+     static const int TRIG_DEGREE = DIGITS > 53 ? 10 : 8;
+     static const int EXP_DEGREE = DIGITS > 53 ? 16 : 14;
+     static const int LOG_DEGREE = DIGITS > 53 ? 12 : 10;
+     static const int FACTORIALS = 2 * TRIG_DEGREE + 4;
+     static const int ODDS = LOG_DEGREE + 2;
+ 
+     W pio2[2], pio2Tail[2], twoOverPi;
+     W ln2[2], ln2Tail[2], invLn2, ln2Dn, ln2Up;
+     W factDn[FACTORIALS], factUp[FACTORIALS];  // 1/k!
+     W oddDn[ODDS], oddUp[ODDS];                // 1/(2k+1)
+ 
+     static const ElementaryConstants &Get() {
+         static const ElementaryConstants c;
+         return c;
      }
-     if (!finished)
-         st = 2;
  
+ private:
+     static const mpfr_prec_t WORK_PREC = 256;
+ 
+     static void Split(mpfr_srcptr cDn, mpfr_srcptr cUp, W hiMid[2], W tail[2]) {
+         mpfr_t part, rest;
+         mpfr_init2(part, DIGITS - 20);
+         mpfr_init2(rest, WORK_PREC);
+         mpfr_set(part, cDn, MPFR_RNDN);
+         hiMid[0] = MpfrGet<W>(part, MPFR_RNDN);
+         mpfr_sub(rest, cDn, part, MPFR_RNDN);
+         mpfr_set(part, rest, MPFR_RNDN);
+         hiMid[1] = MpfrGet<W>(part, MPFR_RNDN);
+         mpfr_set_ld(part, hiMid[0], MPFR_RNDN);
+         mpfr_sub(rest, cDn, part, MPFR_RNDD);
+         mpfr_set_ld(part, hiMid[1], MPFR_RNDN);
+         mpfr_sub(rest, rest, part, MPFR_RNDD);
+         tail[0] = MpfrGet<W>(rest, MPFR_RNDD);
+         mpfr_set_ld(part, hiMid[0], MPFR_RNDN);
+         mpfr_sub(rest, cUp, part, MPFR_RNDU);
+         mpfr_set_ld(part, hiMid[1], MPFR_RNDN);
+         mpfr_sub(rest, rest, part, MPFR_RNDU);
+         tail[1] = MpfrGet<W>(rest, MPFR_RNDU);
+         mpfr_clear(part);
+         mpfr_clear(rest);
+     }
+ 
+     ElementaryConstants() {
+         mpfr_t dn, up, t;
+         mpfr_init2(dn, WORK_PREC);
+         mpfr_init2(up, WORK_PREC);
+         mpfr_init2(t, WORK_PREC);
+ 
+         mpfr_const_pi(dn, MPFR_RNDD);
+         mpfr_const_pi(up, MPFR_RNDU);
+         mpfr_div_2ui(dn, dn, 1, MPFR_RNDD);
+         mpfr_div_2ui(up, up, 1, MPFR_RNDU);
+         Split(dn, up, pio2, pio2Tail);
+         mpfr_ui_div(t, 1, dn, MPFR_RNDN);
+         twoOverPi = MpfrGet<W>(t, MPFR_RNDN);
+ 
+         mpfr_const_log2(dn, MPFR_RNDD);
+         mpfr_const_log2(up, MPFR_RNDU);
+         Split(dn, up, ln2, ln2Tail);
+         ln2Dn = MpfrGet<W>(dn, MPFR_RNDD);
+         ln2Up = MpfrGet<W>(up, MPFR_RNDU);
+         mpfr_ui_div(t, 1, dn, MPFR_RNDN);
+         invLn2 = MpfrGet<W>(t, MPFR_RNDN);
+ 
+         mpfr_set_ui(t, 1, MPFR_RNDN);
+         for (int k = 0; k < FACTORIALS; k++) {
+             if (k > 1)
+                 mpfr_mul_ui(t, t, k, MPFR_RNDN);  // k! jest dokładne w 256 bitach
+             mpfr_ui_div(dn, 1, t, MPFR_RNDD);
+             mpfr_ui_div(up, 1, t, MPFR_RNDU);
+             factDn[k] = MpfrGet<W>(dn, MPFR_RNDD);
+             factUp[k] = MpfrGet<W>(up, MPFR_RNDU);
+         }
+         for (int k = 0; k < ODDS; k++) {
+             mpfr_set_ui(t, 2 * k + 1, MPFR_RNDN);
+             mpfr_ui_div(dn, 1, t, MPFR_RNDD);
+             mpfr_ui_div(up, 1, t, MPFR_RNDU);
+             oddDn[k] = MpfrGet<W>(dn, MPFR_RNDD);
+             oddUp[k] = MpfrGet<W>(up, MPFR_RNDU);
+         }
+         mpfr_clear(dn);
+         mpfr_clear(up);
+         mpfr_clear(t);
+     }
+ };
+ 
+ // Wyraz (-1)^j / k! jako przedział
+ template<typename W>
+ inline void SignedFactorial(const ElementaryConstants<W> &c, int k, int j, W &lo,
+         W &hi) {
+     if (j % 2 == 0) {
+         lo = c.factDn[k];
+         hi = c.factUp[k];
+     } else {
+         lo = -c.factUp[k];
+         hi = -c.factDn[k];
+     }
+ }
+ 
+ // Ogon szeregu w s = r^2 >= 0: s * sum_{j=1..n} c_j s^(j-1), c_j = (-1)^j / (2j + off)!.
+ // Wyraz wiodący dodajemy dopiero na końcu, więc błąd zaokrągleń wyniku to ok. 1 ulp.
+ template<typename W>
+ inline void EvenSeriesTail(const ElementaryConstants<W> &c, int n, int off, W sl, W sh,
+         W &lo, W &hi) {
+     W tl, th;
+     SignedFactorial(c, 2 * n + off, n, lo, hi);
+     for (int j = n - 1; j >= 1; j--) {
+         W pl = lo >= 0 ? MulDown(sl, lo) : MulDown(sh, lo);
+         W ph = hi >= 0 ? sh * hi : sl * hi;
+         SignedFactorial(c, 2 * j + off, j, tl, th);
+         lo = AddDown(tl, pl);
+         hi = th + ph;
+     }
+     W pl = lo >= 0 ? MulDown(sl, lo) : MulDown(sh, lo);
+     W ph = hi >= 0 ? sh * hi : sl * hi;
+     lo = pl;
+     hi = ph;
+ }
+ 
+ // sin(r) dla punktu r, |r| <= ~pi/4: r + r * sum_{j=1..n} (-1)^j r^2j / (2j+1)! + reszta,
+ // |reszta| <= |r|^(2n+3) / (2n+3)!. Wymaga FE_UPWARD.
+ template<typename W>
+ inline void SinKernel(W r, W &lo, W &hi) {
+     const ElementaryConstants<W> &c = ElementaryConstants<W>::Get();
+     const int n = ElementaryConstants<W>::TRIG_DEGREE;
+     W sl = MulDown(r, r), sh = r * r;
+     W ql, qh;
+     EvenSeriesTail(c, n, 1, sl, sh, ql, qh);
+     W e = std::fabs(r) * c.factUp[2 * n + 3];
+     for (int j = 0; j <= n; j++)
+         e = e * sh;
+     if (r >= 0) {
+         lo = AddDown(r, SubDown(MulDown(r, ql), e));
+         hi = r + (r * qh + e);
+     } else {
+         lo = AddDown(r, SubDown(MulDown(r, qh), e));
+         hi = r + (r * ql + e);
+     }
+ }
+ 
+ // cos(r) dla punktu r, |r| <= ~pi/4; |reszta| <= r^(2n+2) / (2n+2)!. Wymaga FE_UPWARD.
+ template<typename W>
+ inline void CosKernel(W r, W &lo, W &hi) {
+     const ElementaryConstants<W> &c = ElementaryConstants<W>::Get();
+     const int n = ElementaryConstants<W>::TRIG_DEGREE;
+     W sl = MulDown(r, r), sh = r * r;
+     W ql, qh;
+     EvenSeriesTail(c, n, 0, sl, sh, ql, qh);
+     W e = c.factUp[2 * n + 2];
+     for (int j = 0; j <= n; j++)
+         e = e * sh;
+     lo = AddDown(W(1), SubDown(ql, e));
+     hi = W(1) + (qh + e);
+ }
+ 
+ // exp(r) dla punktu r, |r| <= ~ln2/2: 1 + r * sum_{j=1..n} r^(j-1) / j! + reszta,
+ // |reszta| <= e^|r| |r|^(n+1) / (n+1)! <= 2 |r|^(n+1) / (n+1)!
+ template<typename W>
+ inline void ExpKernel(W r, W &lo, W &hi) {
+     const ElementaryConstants<W> &c = ElementaryConstants<W>::Get();
+     const int n = ElementaryConstants<W>::EXP_DEGREE;
+     lo = c.factDn[n];
+     hi = c.factUp[n];
+     for (int j = n - 1; j >= 1; j--) {
+         W pl, ph;
+         if (r >= 0) {
+             pl = MulDown(r, lo);
+             ph = r * hi;
+         } else {
+             pl = MulDown(r, hi);
+             ph = r * lo;
+         }
+         lo = AddDown(c.factDn[j], pl);
+         hi = c.factUp[j] + ph;
+     }
+     W a = std::fabs(r);
+     W e = 2 * c.factUp[n + 1];
+     for (int j = 0; j <= n; j++)
+         e = e * a;
+     W pl, ph;
+     if (r >= 0) {
+         pl = MulDown(r, lo);
+         ph = r * hi;
+     } else {
+         pl = MulDown(r, hi);
+         ph = r * lo;
+     }
+     lo = AddDown(W(1), SubDown(pl, e));
+     hi = W(1) + (ph + e);
+ }
+ 
+ // 2 atanh(t) = 2t + 2t * sum_{j=1..n} t^2j / (2j+1) + reszta dla |t| <= 3 - 2 sqrt(2);
+ // |reszta| <= 2 |t|^(2n+3) / ((2n+3) (1 - t^2)) <= 2.125 |t|^(2n+3) / (2n+3)
+ template<typename W>
+ inline void AtanhKernel(W t, W &lo, W &hi) {
+     const ElementaryConstants<W> &c = ElementaryConstants<W>::Get();
+     const int n = ElementaryConstants<W>::LOG_DEGREE;
+     W sl = MulDown(t, t), sh = t * t;
+     W ql = c.oddDn[n], qh = c.oddUp[n];
+     for (int j = n - 1; j >= 1; j--) {
+         ql = AddDown(c.oddDn[j], MulDown(sl, ql));
+         qh = c.oddUp[j] + sh * qh;
+     }
+     ql = MulDown(sl, ql);
+     qh = sh * qh;
+     W t2 = 2 * t;
+     W e = W(2.125) * std::fabs(t) * c.oddUp[n + 1];
+     for (int j = 0; j <= n; j++)
+         e = e * sh;
+     if (t >= 0) {
+         lo = AddDown(t2, SubDown(MulDown(t2, ql), e));
+         hi = t2 + (t2 * qh + e);
+     } else {
+         lo = AddDown(t2, SubDown(MulDown(t2, qh), e));
+         hi = t2 + (t2 * ql + e);
+     }
+ }
+ 
+ // r = x - k*(hi + mid + [tail]) jako przedział [rl, rh]; hi*k i mid*k są dokładne
+ template<typename W>
+ inline void ReduceArgument(W x, W k, const W hiMid[2], const W tail[2], W &rl,
+         W &rh) {
+     W p0 = k * hiMid[0], p1 = k * hiMid[1];
+     W tl, th;
+     if (k >= 0) {
+         tl = MulDown(k, tail[0]);
+         th = k * tail[1];
+     } else {
+         tl = MulDown(k, tail[1]);
+         th = k * tail[0];
+     }
+     rl = SubDown(SubDown(SubDown(x, p0), p1), th);
+     rh = ((x - p0) - p1) - tl;
+ }
+ 
+ // Ekstrema sin/cos w punktach k*pi/2, kmin <= k <= kmin + span (kmin = residue mod 4).
+ // Bit 1: przedział osiąga maksimum 1, bit 2: minimum -1.
+ inline int TrigExtremaFlags(int kind, long residue, long span) {
+     if (span >= 3)
+         return 3;
+     int flags = 0;
+     for (long j = 0; j <= span; j++) {
+         int e = (int) ((residue + j + kind) & 3);
+         if (e == 1)
+             flags |= 1;
+         else if (e == 3)
+             flags |= 2;
+     }
+     return flags;
+ }
+ 
+ // sin (kind = 0) lub cos (kind = 1) w punkcie x: x = k*pi/2 + r, rsign to znak r
+ // (0 gdy niepewny). Zwraca false, gdy |x| jest za duże na redukcję w typie W.
+ template<typename W>
+ inline bool TrigPoint(W x, int kind, long &k, int &rsign, W &lo, W &hi) {
+     const ElementaryConstants<W> &c = ElementaryConstants<W>::Get();
+     if (!(std::fabs(x) <= W(524288)))
+         return false;
+     k = (long) std::floor(x * c.twoOverPi + W(0.5));
+     W rl, rh;
+     ReduceArgument(x, (W) k, c.pio2, c.pio2Tail, rl, rh);
+     rsign = rl > 0 ? 1 : (rh < 0 ? -1 : 0);
+     int e = (int) ((k + kind) & 3);
+     // Jądro liczymy tylko w rl; zmiana na [rl, rh] jest ograniczona przez d = rh - rl,
+     // bo |sin'| i |cos'| <= 1, a kierunek zmiany wynika z monotoniczności na [-pi/4, pi/4]
+     W d = rh - rl;
+     if ((e & 1) == 0) {
+         SinKernel(rl, lo, hi);
+         hi = hi + d;
+     } else {
+         CosKernel(rl, lo, hi);
+         if (rl >= 0)
+             lo = SubDown(lo, d);
+         else if (rh <= 0)
+             hi = hi + d;
+         else {
+             lo = SubDown(lo, d);
+             hi = W(1);
+         }
+     }
+     if (e >= 2) {
+         W t = lo;
+         lo = -hi;
+         hi = -t;
+     }
+     return true;
+ }
+ 
+ // Dolne (upper == false) lub górne ograniczenie exp(x): x = k ln2 + r, exp(x) = 2^k exp(r)
+ template<typename W>
+ inline W ExpBound(W x, bool upper) {
+     const ElementaryConstants<W> &c = ElementaryConstants<W>::Get();
+     if (x != x)
+         return x;
+     if (x > W(0.7) * (std::numeric_limits<W>::max_exponent + 1))
+         return upper ?
+                 std::numeric_limits<W>::infinity() : std::numeric_limits<W>::max();
+     if (x < W(0.7) * (std::numeric_limits<W>::min_exponent - std::numeric_limits<W>::digits - 1))
+         return upper ? std::numeric_limits<W>::denorm_min() : W(0);
+     int k = (int) std::floor(x * c.invLn2 + W(0.5));
+     W rl, rh, lo, hi;
+     ReduceArgument(x, (W) k, c.ln2, c.ln2Tail, rl, rh);
+     if (upper) {
+         ExpKernel(rh, lo, hi);
+         return std::ldexp(hi, k);
+     }
+     ExpKernel(rl, lo, hi);
+     return -RoundBarrier(std::ldexp(RoundBarrier(-lo), k));
+ }
+ 
+ // Dolne lub górne ograniczenie log(x) dla x >= 0: x = m 2^e, m w [sqrt(1/2), sqrt(2)),
+ // log(x) = e ln2 + 2 atanh((m - 1) / (m + 1))
+ template<typename W>
+ inline W LogBound(W x, bool upper) {
+     const ElementaryConstants<W> &c = ElementaryConstants<W>::Get();
+     if (!(x >= 0))
+         return std::numeric_limits<W>::quiet_NaN();
+     if (x == 0)
+         return -std::numeric_limits<W>::infinity();
+     if (x == std::numeric_limits<W>::infinity())
+         return upper ?
+                 std::numeric_limits<W>::infinity() : std::numeric_limits<W>::max();
+     int e;
+     W m = std::frexp(x, &e);
+     if (m < W(0.70710678118654752440L)) {
+         m = 2 * m;
+         e--;
+     }
+     W num = m - 1;  // dokładne (lemat Sterbenza)
+     W dl = AddDown(m, W(1)), dh = m + 1;
+     W t, lo, hi;
+     if (upper)
+         t = num >= 0 ? num / dl : num / dh;
+     else
+         t = num >= 0 ? DivDown(num, dh) : DivDown(num, dl);
+     AtanhKernel(t, lo, hi);
+     W we = (W) e;
+     if (upper)
+         return (e >= 0 ? we * c.ln2Up : we * c.ln2Dn) + hi;
+     return AddDown(e >= 0 ? MulDown(we, c.ln2Dn) : MulDown(we, c.ln2Up), lo);
+ }
+ 
+ // Dolne ograniczenie sqrt(x) przy FE_UPWARD: sqrt w górę, a gdy wynik nie jest dokładny,
+ // poprzednia liczba (pierwiastek zaokrąglony w dół różni się od tego w górę o co najwyżej 1 ulp)
+ template<typename W>
+ inline W SqrtDown(W x) {
+     W r = std::sqrt(x);
+     if (!std::isfinite(r) || (MulDown(r, r) == x && r * r == x))
+         return r;
+     return std::nextafter(r, W(0));
+ }
+ 
+ // --- ścieżka MPFR ---
+ 
+ inline void MpfrSetFloat128(mpfr_ptr rop, __float128 x) {
+     long double hi = (long double) x;
+     mpfr_set_ld(rop, hi, MPFR_RNDN);
+     if (!std::isfinite(hi))
+         return;
+     long double lo = (long double) (x - (__float128) hi);
+     mpfr_ptr rest = MpfrScratch::Get(1, 64);
+     mpfr_set_ld(rest, lo, MPFR_RNDN);
+     mpfr_add(rop, rop, rest, MPFR_RNDN);
+ }
+ 
+ // k = round(x / (pi/2)) oraz znak x - k*pi/2 (0 gdy niepewny). Precyzja ilorazu rośnie
+ // z wykładnikiem x, więc błąd bezwzględny ilorazu jest poniżej 2^-(prec(x)+60).
+ inline int MpfrQuadrant(mpfr_srcptr x, mpfr_ptr k) {
+     mpfr_prec_t p = mpfr_get_prec(x) + 64;
+     if (mpfr_regular_p(x) && mpfr_get_exp(x) > 0)
+         p += mpfr_get_exp(x);
+     mpfr_t q;
+     mpfr_init2(q, p);
+     mpfr_set_prec(k, p);
+     mpfr_const_pi(q, MPFR_RNDN);
+     mpfr_div_2ui(q, q, 1, MPFR_RNDN);
+     mpfr_div(q, x, q, MPFR_RNDN);
+     mpfr_rint(k, q, MPFR_RNDN);
+     mpfr_sub(q, q, k, MPFR_RNDN);
+     int sign = 0;
+     if (!mpfr_zero_p(q) && mpfr_get_exp(q) > -(mpfr_exp_t) mpfr_get_prec(x) - 32)
+         sign = mpfr_sgn(q);
+     mpfr_clear(q);
+     return sign;
+ }
+ 
+ inline void MpfrTrigRange(mpfr_srcptr a, mpfr_srcptr b, int kind, mpfr_ptr lo,
+         mpfr_ptr hi) {
+     if (!mpfr_number_p(a) || !mpfr_number_p(b)) {
+         mpfr_set_si(lo, -1, MPFR_RNDN);
+         mpfr_set_si(hi, 1, MPFR_RNDN);
+         return;
+     }
+     int (*f)(mpfr_ptr, mpfr_srcptr, mpfr_rnd_t) = kind == ELEM_SIN ? mpfr_sin : mpfr_cos;
+     mpfr_t t, ka, kb;
+     mpfr_init2(t, mpfr_get_prec(lo));
+     mpfr_init2(ka, 2);
+     mpfr_init2(kb, 2);
+     f(lo, a, MPFR_RNDD);
+     f(t, b, MPFR_RNDD);
+     if (mpfr_less_p(t, lo))
+         mpfr_set(lo, t, MPFR_RNDD);
+     mpfr_set_prec(t, mpfr_get_prec(hi));
+     f(hi, a, MPFR_RNDU);
+     f(t, b, MPFR_RNDU);
+     if (mpfr_greater_p(t, hi))
+         mpfr_set(hi, t, MPFR_RNDU);
+ 
+     if (MpfrQuadrant(a, ka) > 0)
+         mpfr_add_ui(ka, ka, 1, MPFR_RNDN);
+     if (MpfrQuadrant(b, kb) < 0)
+         mpfr_sub_ui(kb, kb, 1, MPFR_RNDN);
+     mpfr_set_prec(t, std::max(mpfr_get_prec(ka), mpfr_get_prec(kb)) + 1);
+     mpfr_sub(t, kb, ka, MPFR_RNDN);
+     long span = mpfr_cmp_ui(t, 3) >= 0 ? 3 : mpfr_get_si(t, MPFR_RNDN);
+     long residue = 0;
+     if (span >= 0 && span < 3) {
+         mpfr_set_ui(t, 4, MPFR_RNDN);
+         mpfr_fmod(t, ka, t, MPFR_RNDN);
+         residue = mpfr_get_si(t, MPFR_RNDN);
+     }
+     int flags = TrigExtremaFlags(kind, residue, span);
+     if ((flags & 1) || mpfr_cmp_si(hi, 1) > 0)
+         mpfr_set_si(hi, 1, MPFR_RNDN);
+     if ((flags & 2) || mpfr_cmp_si(lo, -1) < 0)
+         mpfr_set_si(lo, -1, MPFR_RNDN);
+     mpfr_clear(t);
+     mpfr_clear(ka);
+     mpfr_clear(kb);
+ }
+ 
+ // Obraz [a, b] przez funkcję kind; lo i hi mają docelową precyzję
+ inline void MpfrElementaryRange(ElementaryKind kind, mpfr_srcptr a, mpfr_srcptr b,
+         mpfr_ptr lo, mpfr_ptr hi) {
+     switch (kind) {
+     case ELEM_SIN:
+     case ELEM_COS:
+         MpfrTrigRange(a, b, kind, lo, hi);
+         break;
+     case ELEM_EXP:
+         mpfr_exp(lo, a, MPFR_RNDD);
+         mpfr_exp(hi, b, MPFR_RNDU);
+         break;
+     case ELEM_LOG:
+         mpfr_log(lo, a, MPFR_RNDD);
+         mpfr_log(hi, b, MPFR_RNDU);
+         break;
+     case ELEM_SQRT:
+         mpfr_sqrt(lo, a, MPFR_RNDD);
+         mpfr_sqrt(hi, b, MPFR_RNDU);
+         break;
+     }
+ }
+ 
+ template<typename T>
+ inline Interval<T> MpfrElementary(const Interval<T> &x, ElementaryKind kind) {
      Interval<T> r;
-     r.a = 0;
-     r.b = 0;
+     if constexpr (std::is_same<T, mpreal>::value) {
+         r.a.set_prec(Interval<T>::GetPrecision());
+         r.b.set_prec(Interval<T>::GetPrecision());
+         MpfrElementaryRange(kind, x.a.mpfr_srcptr(), x.b.mpfr_srcptr(), r.a.mpfr_ptr(),
+                 r.b.mpfr_ptr());
+     } else {
+         mpfr_prec_t p;
+         if constexpr (std::is_same<T, __float128>::value)
+             p = FLOAT128_PREC;
+         else
+             p = std::numeric_limits<T>::digits;
+         mpfr_t a, b, lo, hi;
+         mpfr_init2(a, p);
+         mpfr_init2(b, p);
+         mpfr_init2(lo, p);
+         mpfr_init2(hi, p);
+         if constexpr (std::is_same<T, __float128>::value) {
+             MpfrSetFloat128(a, x.a);
+             MpfrSetFloat128(b, x.b);
+         } else {
+             mpfr_set_ld(a, x.a, MPFR_RNDN);
+             mpfr_set_ld(b, x.b, MPFR_RNDN);
+         }
+         MpfrElementaryRange(kind, a, b, lo, hi);
+         r.a = MpfrGet<T>(lo, MPFR_RNDD);
+         r.b = MpfrGet<T>(hi, MPFR_RNDU);
+         mpfr_clear(a);
+         mpfr_clear(b);
+         mpfr_clear(lo);
+         mpfr_clear(hi);
+     }
      return r;
  }
  
+ // --- przedziałowe wersje dla float/double/long double, wymagają FE_UPWARD ---
+ 
+ template<typename T>
+ inline Interval<T> FastTrigUp(const Interval<T> &x, int kind) {
+     typedef typename ElementaryWork<T>::type W;
+     Interval<T> r(0, 0);
+     if (x.a > x.b)
+         return r;
+     long ka, kb;
+     int sa, sb;
+     W la, ha, lb, hb;
+     if (!TrigPoint((W) x.a, kind, ka, sa, la, ha)
+             || !TrigPoint((W) x.b, kind, kb, sb, lb, hb)) {
+         SetRounding<T>(FE_TONEAREST);
+         r = MpfrElementary(x, (ElementaryKind) kind);
+         SetRounding<T>(FE_UPWARD);
+         return r;
+     }
+     W lo = std::min(la, lb), hi = std::max(ha, hb);
+     long kmin = ka + (sa > 0 ? 1 : 0), kmax = kb - (sb < 0 ? 1 : 0);
+     int flags = TrigExtremaFlags(kind, kmin & 3, kmax - kmin);
+     if ((flags & 1) || hi > 1)
+         hi = 1;
+     if ((flags & 2) || lo < -1)
+         lo = -1;
+     r.a = NarrowDown<T>(lo);
+     r.b = NarrowUp<T>(hi);
+     return r;
+ }
+ 
+ template<typename T>
+ inline Interval<T> FastExpUp(const Interval<T> &x) {
+     typedef typename ElementaryWork<T>::type W;
+     Interval<T> r(0, 0);
+     if (x.a > x.b)
+         return r;
+     r.a = NarrowDown<T>(ExpBound((W) x.a, false));
+     r.b = NarrowUp<T>(ExpBound((W) x.b, true));
+     return r;
+ }
+ 
+ template<typename T>
+ inline Interval<T> FastLogUp(const Interval<T> &x, int &st) {
+     typedef typename ElementaryWork<T>::type W;
+     Interval<T> r(0, 0);
+     if (x.a > x.b)
+         st = 1;
+     else if (x.a < 0)
+         st = 2;
+     else {
+         st = 0;
+         r.a = NarrowDown<T>(LogBound((W) x.a, false));
+         r.b = NarrowUp<T>(LogBound((W) x.b, true));
+     }
+     return r;
+ }
+ 
+ template<typename T>
+ inline Interval<T> FastSqrtUp(const Interval<T> &x, int &st) {
+     Interval<T> r(0, 0);
+     if (x.a > x.b)
+         st = 1;
+     else if (x.a < 0)
+         st = 2;
+     else {
+         st = 0;
+         r.a = SqrtDown(x.a);
+         r.b = std::sqrt(x.b);
+     }
+     return r;
+ }
+ 
+ template<typename T>
+ Interval<T> ISin(const Interval<T> &x) {
+     if constexpr (FastElementaryType<T>::value) {
+         SetRounding<T>(FE_UPWARD);
+         Interval<T> r = FastTrigUp(x, ELEM_SIN);
+         SetRounding<T>(FE_TONEAREST);
+         return r;
+     } else {
+         if (x.a > x.b)
+             return Interval<T>(0, 0);
+         return MpfrElementary(x, ELEM_SIN);
+     }
+ }
+ 
  template<typename T>
  Interval<T> ICos(const Interval<T> &x) {
-     Interval<T> c, d, w, w1, x2;
-     int k, st;
-     bool is_even, finished;
+     if constexpr (FastElementaryType<T>::value) {
+         SetRounding<T>(FE_UPWARD);
+         Interval<T> r = FastTrigUp(x, ELEM_COS);
+         SetRounding<T>(FE_TONEAREST);
+         return r;
+     } else {
+         if (x.a > x.b)
+             return Interval<T>(0, 0);
+         return MpfrElementary(x, ELEM_COS);
+     }
+ }
  
-     c.a = 1;
-     c.b = 1;
-     w = c;
-     x2 = IMul(x, x);
-     k = 1;
-     is_even = true;
-     finished = false;
-     st = 0;
+ template<typename T>
+ Interval<T> IExp(const Interval<T> &x) {
+     if constexpr (FastElementaryType<T>::value) {
+         SetRounding<T>(FE_UPWARD);
+         Interval<T> r = FastExpUp(x);
+         SetRounding<T>(FE_TONEAREST);
+         return r;
+     } else {
+         if (x.a > x.b)
+             return Interval<T>(0, 0);
+         return MpfrElementary(x, ELEM_EXP);
+     }
+ }
  
-     do {
-         d.a = k * (k + 1);
-         d.b = d.a;
-         c = IMul(c, IDiv(x2, d));
-         if (is_even) {
-             w1 = ISub(w, c);
-         } else {
-             w1 = IAdd(w, c);
+ template<typename T>
+ Interval<T> ILog(const Interval<T> &x, int &st) {
+     if constexpr (FastElementaryType<T>::value) {
+         SetRounding<T>(FE_UPWARD);
+         Interval<T> r = FastLogUp(x, st);
+         SetRounding<T>(FE_TONEAREST);
+         return r;
+     } else {
+         if (x.a > x.b) {
+             st = 1;
+             return Interval<T>(0, 0);
          }
-         if ((w.a != 0) && (w.b != 0)) {
-             if (((abs(w.a - w1.a) / abs(w.a)) < 1e-18)
-                     && (abs(w.b - w1.b) / abs(w.b) < 1e-18))
-                 finished = true;
-         } else {
-             if ((w.a == 0) && (w.b != 0)) {
-                 if ((abs(w.a - w1.a) < 1e-18)
-                         && (abs(w.b - w1.b) / abs(w.b) < 1e-18)) {
-                     finished = true;
-                 }
-             } else if (w.a != 0) {
-                 if ((abs(w.a - w1.a) / abs(w.a) < 1e-18)
-                         && (abs(w.b - w1.b) < 1e-18))
-                     finished = true;
-             } else if ((abs(w.a - w1.a) < 1e-18) && (abs(w.b - w1.b) < 1e-18))
-                 finished = true;
+         if (x.a < 0) {
+             st = 2;
+             return Interval<T>(0, 0);
+         }
+         st = 0;
+         return MpfrElementary(x, ELEM_LOG);
+     }
+ }
+ 
+ // Wersje paczkowe: dla typów sprzętowych tryb zaokrąglenia przełączany jest raz na całą
+ // tablicę. st (log, sqrt) to największy kod błędu z elementów; błędne elementy dają [0, 0].
+ template<typename T>
+ void ISinBatch(const Interval<T> *x, Interval<T> *r, size_t n) {
+     if constexpr (FastElementaryType<T>::value) {
+         SetRounding<T>(FE_UPWARD);
+         for (size_t i = 0; i < n; i++)
+             r[i] = FastTrigUp(x[i], ELEM_SIN);
+         SetRounding<T>(FE_TONEAREST);
+     } else {
+         for (size_t i = 0; i < n; i++)
+             r[i] = ISin(x[i]);
+     }
+ }
+ 
+ template<typename T>
+ void ICosBatch(const Interval<T> *x, Interval<T> *r, size_t n) {
+     if constexpr (FastElementaryType<T>::value) {
+         SetRounding<T>(FE_UPWARD);
+         for (size_t i = 0; i < n; i++)
+             r[i] = FastTrigUp(x[i], ELEM_COS);
+         SetRounding<T>(FE_TONEAREST);
+     } else {
+         for (size_t i = 0; i < n; i++)
+             r[i] = ICos(x[i]);
+     }
+ }
+ 
+ template<typename T>
+ void IExpBatch(const Interval<T> *x, Interval<T> *r, size_t n) {
+     if constexpr (FastElementaryType<T>::value) {
+         SetRounding<T>(FE_UPWARD);
+         for (size_t i = 0; i < n; i++)
+             r[i] = FastExpUp(x[i]);
+         SetRounding<T>(FE_TONEAREST);
+     } else {
+         for (size_t i = 0; i < n; i++)
+             r[i] = IExp(x[i]);
+     }
+ }
  
+ template<typename T>
+ void ILogBatch(const Interval<T> *x, Interval<T> *r, size_t n, int &st) {
+     int s;
+     st = 0;
+     if constexpr (FastElementaryType<T>::value) {
+         SetRounding<T>(FE_UPWARD);
+         for (size_t i = 0; i < n; i++) {
+             r[i] = FastLogUp(x[i], s);
+             st = std::max(st, s);
          }
-         if (finished) {
-             if (w1.b > 1) {
-                 w1.b = 1;
-                 if (w1.a > 1)
-                     w1.a = 1;
-             }
-             if (w1.a < -1) {
-                 w1.a = -1;
-                 if (w1.b < -1)
-                     w1.b = -1;
-             }
-             return w1;
-         } else {
-             w = w1;
-             k = k + 2;
-             is_even = !is_even;
+         SetRounding<T>(FE_TONEAREST);
+     } else {
+         for (size_t i = 0; i < n; i++) {
+             r[i] = ILog(x[i], s);
+             st = std::max(st, s);
          }
- 
-     } while (!finished || (k > INT_MAX / 2));
- 
-     if (!finished)
-         st = 2;
- 
-     Interval<T> r;
-     r.a = 0;
-     r.b = 0;
-     return r;
+     }
  }
  
+ template<typename T> Interval<T> ISqrt(const Interval<T> &x, int &st);
+ 
  template<typename T>
- Interval<T> IExp(const Interval<T> &x) {
-     bool finished;
-     int k;
-     int st = 0;
-     Interval<T> d, e, w, w1;
-     string left, right;
-     Interval<T> tmp = x;
-     T eps = 1E-18; //2*Interval<T>::GetEpsilon();
-     T diff = std::numeric_limits<T>::max();
-     if ((x.a < 0) && (x.b > 0))
-         return {1,1};
-     if (x.a > x.b)
-         st = 1;
-     else {
-         e.a = 1;
-         e.b = 1;
-         w = e;
-         k = 1;
-         finished = false;
-         st = 0;
-         do {
-             d.a = k;
-             d.b = k;
-             e = IMul(e, IDiv(x, d));
-             w1 = IAdd(w, e);
-             T oldMid = (w.a + w.b) / 2;
-             T newMid = (w1.a + w1.b) / 2;
-             T currDiff = abs(oldMid - newMid);
-             //finished = (currDiff >= diff);
-             T tmpDiff = diff - currDiff;
-             diff = currDiff;
-             if ((abs(w.a - w1.a) / abs(w.a) < eps)
-                     && (abs(w.b - w1.b) / abs(w.b) < eps)) {
-                 finished = true;
-                 return w1;
-             } else {
-                 w = w1;
-                 k = k + 1;
-                 if (k > 100000) {
-                     T wdth = w.GetWidth();
- 
-                     tmp.IEndsToStrings(left, right);
-                     cout << "x=[" << left << "," << right << "]" << endl;
-                     w.IEndsToStrings(left, right);
-                     cout << "[" << left << "," << right << "]" << endl;
-                     cout << "      width =  " << std::setprecision(17) << wdth
-                             << endl << " diff = " << diff << endl
-                             << " tmpDiff = " << tmpDiff << endl << "eps = "
-                             << eps << endl;
-                 }
-             }
-         } while (!(finished || (k > INT_MAX / 2)));
-         if (!finished)
-             st = 2;
+ void ISqrtBatch(const Interval<T> *x, Interval<T> *r, size_t n, int &st) {
+     int s;
+     st = 0;
+     if constexpr (FastElementaryType<T>::value) {
+         SetRounding<T>(FE_UPWARD);
+         for (size_t i = 0; i < n; i++) {
+             r[i] = FastSqrtUp(x[i], s);
+             st = std::max(st, s);
+         }
+         SetRounding<T>(FE_TONEAREST);
+     } else {
+         for (size_t i = 0; i < n; i++) {
+             r[i] = ISqrt(x[i], s);
+             st = std::max(st, s);
+         }
      }
-     Interval<T> r;
-     r.a = 0;
-     r.b = 0;
-     return r;
  }
  
  template<typename T>
@@ -798,23 +1651,23 @@
  
  template<typename T>
  Interval<T> ISqrt(const Interval<T> &x, int &st) {
-     Interval<T> r;
-     r.a = 0;
-     r.b = 0;
-     if (x.a > x.b) {
-         st = 1;
-     } else if (x.a < 0) {
-         st = 2;
-     } else {
-         st = 0;
-         SetRounding<T>(FE_DOWNWARD);
-         r.a = sqrt(x.a);
+     if constexpr (FastElementaryType<T>::value) {
          SetRounding<T>(FE_UPWARD);
-         r.b = sqrt(x.b);
+         Interval<T> r = FastSqrtUp(x, st);
          SetRounding<T>(FE_TONEAREST);
+         return r;
+     } else {
+         if (x.a > x.b) {
+             st = 1;
+             return Interval<T>(0, 0);
+         }
+         if (x.a < 0) {
+             st = 2;
+             return Interval<T>(0, 0);
+         }
+         st = 0;
+         return MpfrElementary(x, ELEM_SQRT);
      }
- 
-     return r;
  }
  
  template<typename T>
@@ -875,7 +1728,7 @@
  template<typename T>
  Interval<T> IDiv(const Interval<T> &x, const Interval<T> &y) {
      Interval<T> r;
-     T x1y1, x1y2, x2y1, t;
+     T x1y1, x1y2, x2y1;
  
      if ((y.a <= 0) && (y.b >= 0)) {
          throw runtime_error("Division by an interval containing 0.");
@@ -885,12 +1738,11 @@
          x1y2 = x.a / y.b;
          x2y1 = x.b / y.a;
          r.a = x.b / y.b;
-         t = r.a;
-         if (x2y1 < t)
+         if (x2y1 < r.a)
              r.a = x2y1;
-         if (x1y2 < t)
+         if (x1y2 < r.a)
              r.a = x1y2;
-         if (x1y1 < t)
+         if (x1y1 < r.a)
              r.a = x1y1;
  
          SetRounding<T>(FE_UPWARD);
@@ -899,12 +1751,11 @@
          x2y1 = x.b / y.a;
  
          r.b = x.b / y.b;
-         t = r.b;
-         if (x2y1 > t)
+         if (x2y1 > r.b)
              r.b = x2y1;
-         if (x1y2 > t)
+         if (x1y2 > r.b)
              r.b = x1y2;
-         if (x1y1 > t)
+         if (x1y1 > r.b)
              r.b = x1y1;
  
      }
@@ -1039,7 +1890,7 @@
                  SetRounding<T>(FE_UPWARD);
                  z1.b = x.b * y.b;
                  z2.a = x.a * y.b;
-             } else if ((x.a <= 0) && yn) {
+             } else if ((x.a <= x.b) && yn) {
                  SetRounding<T>(FE_DOWNWARD);
                  z1.a = x.b * y.a;
                  z2.b = x.a * y.a;
@@ -1187,6 +2038,301 @@
      return r;
  }
  
+ // ------------------------------------------------------------------------------------
+ // Paczkowe działania na przedziałach skierowanych (Kauchera) w układzie SoA.
+ // Wynik każdego działania to z1 = [dół w dół, góra w górę] albo z2 = [dół w górę,
+ // góra w dół] – tak samo jak w DIAdd/DISub/DIMul/DIDiv wybieramy ten o większej
+ // szerokości GetWidth (lub z1, gdy oba argumenty są właściwe). Każdy koniec jest jednym
+ // wyrażeniem bez rozgałęzień, poprawnym w bieżącym trybie zaokrąglenia, więc blok liczony
+ // jest dwa razy (FE_DOWNWARD, potem FE_UPWARD) prostymi pętlami, które kompilator może
+ // wektoryzować. Wyniki są identyczne z wersjami skalarnymi.
+ 
+ template<typename T>
+ struct IntervalArray {
+     std::vector<T> a;
+     std::vector<T> b;
+ 
+     IntervalArray() {
+     }
+     explicit IntervalArray(size_t n) :
+             a(n), b(n) {
+     }
+     size_t size() const {
+         return a.size();
+     }
+     void resize(size_t n) {
+         a.resize(n);
+         b.resize(n);
+     }
+     Interval<T> Get(size_t i) const {
+         return Interval<T>(a[i], b[i]);
+     }
+     void Set(size_t i, const Interval<T> &x) {
+         a[i] = x.a;
+         b[i] = x.b;
+     }
+ };
+ 
+ template<typename T>
+ inline T KMax(T u, T v) {
+     return u < v ? v : u;
+ }
+ 
+ template<typename T>
+ inline T KMin(T u, T v) {
+     return u < v ? u : v;
+ }
+ 
+ // Iloczyn Kauchera: [max(a1+ b1+, a2- b2-) - max(a2+ b1-, a1- b2+),
+ //                    max(a2+ b2+, a1- b1-) - max(a1+ b2-, a2- b1+)],
+ // u+ = max(u, 0), u- = max(-u, 0). Odejmowane maksimum zapisujemy jako minimum iloczynów
+ // o przeciwnym znaku, więc każdy iloczyn jest zaokrąglony we właściwą stronę. W każdym
+ // końcu co najwyżej jeden ze składników jest niezerowy, więc suma jest dokładna.
+ template<typename T>
+ inline T KaucherMulLower(T a1, T a2, T b1, T b2) {
+     const T z = 0;
+     return KMax(KMax(a1, z) * KMax(b1, z), KMin(a2, z) * KMin(b2, z))
+             + KMin(KMax(a2, z) * KMin(b1, z), KMin(a1, z) * KMax(b2, z));
+ }
+ 
+ template<typename T>
+ inline T KaucherMulUpper(T a1, T a2, T b1, T b2) {
+     const T z = 0;
+     return KMax(KMax(a2, z) * KMax(b2, z), KMin(a1, z) * KMin(b1, z))
+             + KMin(KMax(a1, z) * KMin(b2, z), KMin(a2, z) * KMax(b1, z));
+ }
+ 
+ // Iloraz Kauchera dla y > 0: [a1 / (a1 >= 0 ? b2 : b1), a2 / (a2 >= 0 ? b1 : b2)];
+ // dla y < 0 korzystamy z x / y = (-x) / (-y). Flaga zero – y zawiera 0.
+ template<typename T>
+ inline void KaucherDivNormalize(T &a1, T &a2, T &b1, T &b2, bool &zero) {
+     bool neg = (b1 < 0) & (b2 < 0);
+     zero = !neg & !((b1 > 0) & (b2 > 0));
+     T n1 = neg ? -a2 : a1, n2 = neg ? -a1 : a2;
+     T d1 = neg ? -b2 : b1, d2 = neg ? -b1 : b2;
+     a1 = n1;
+     a2 = n2;
+     b1 = zero ? T(1) : d1;
+     b2 = zero ? T(1) : d2;
+ }
+ 
+ template<typename T>
+ inline T KaucherDivLower(T a1, T b1, T b2) {
+     return a1 / (a1 >= 0 ? b2 : b1);
+ }
+ 
+ template<typename T>
+ inline T KaucherDivUpper(T a2, T b1, T b2) {
+     return a2 / (a2 >= 0 ? b1 : b2);
+ }
+ 
+ // Wybór z1 = [lo, hi] lub z2 = [loIn, hiIn] jak w skalarnych DI*; wymaga FE_UPWARD
+ template<typename T>
+ inline bool DIPickOuter(bool proper, bool dint, T lo, T hi, T loIn, T hiIn) {
+     T w1 = hi - lo, w2 = hiIn - loIn;
+     // Bariera nie pozwala zwinąć |lo - hi| do |hi - lo| (inne zaokrąglenie)
+     T d1 = KMax(abs(w1), abs(RoundBarrier(lo) - hi));
+     T d2 = KMax(abs(w2), abs(RoundBarrier(loIn) - hiIn));
+     return proper | (dint ? d1 >= d2 : w1 >= w2);
+ }
+ 
+ // Bufory loDn/hiDn są lokalne, więc bez tej bariery kompilator mógłby policzyć ich
+ // zawartość dopiero po zmianie trybu zaokrąglenia
+ template<typename T>
+ inline void DIRoundingFence(T *lo, T *hi) {
+ #if defined(__GNUC__)
+     __asm__ volatile("" : : "r"(lo), "r"(hi) : "memory");
+ #endif
+ }
+ 
+ enum DIOperation {
+     DI_ADD, DI_SUB, DI_MUL, DI_DIV
+ };
+ 
+ template<typename T, DIOperation OP>
+ inline void DIBounds(T a1, T a2, T b1, T b2, T &lo, T &hi) {
+     if constexpr (OP == DI_ADD) {
+         lo = a1 + b1;
+         hi = a2 + b2;
+     } else if constexpr (OP == DI_SUB) {
+         lo = a1 - b2;
+         hi = a2 - b1;
+     } else if constexpr (OP == DI_MUL) {
+         lo = KaucherMulLower(a1, a2, b1, b2);
+         hi = KaucherMulUpper(a1, a2, b1, b2);
+     } else {
+         bool zero;
+         KaucherDivNormalize(a1, a2, b1, b2, zero);
+         lo = KaucherDivLower(a1, b1, b2);
+         hi = KaucherDivUpper(a2, b1, b2);
+     }
+ }
+ 
+ // Rdzeń paczkowy; r może wskazywać na te same tablice co x lub y
+ template<typename T, DIOperation OP>
+ void DIBatch(const T *xa, const T *xb, const T *ya, const T *yb, T *ra, T *rb,
+         size_t n) {
+     const size_t BLOCK = 256;
+     T loDn[BLOCK], hiDn[BLOCK];
+     bool dint = Interval<T>::GetMode() == DINT_MODE;
+     bool zero = false;
+     for (size_t start = 0; start < n; start += BLOCK) {
+         size_t m = std::min(BLOCK, n - start);
+         const T *x1 = xa + start, *x2 = xb + start, *y1 = ya + start, *y2 = yb + start;
+         SetRounding<T>(FE_DOWNWARD);
+         for (size_t i = 0; i < m; i++)
+             DIBounds<T, OP>(x1[i], x2[i], y1[i], y2[i], loDn[i], hiDn[i]);
+         DIRoundingFence(loDn, hiDn);
+         SetRounding<T>(FE_UPWARD);
+         for (size_t i = 0; i < m; i++) {
+             T loUp, hiUp;
+             bool proper = (x1[i] <= x2[i]) & (y1[i] <= y2[i]);
+             if constexpr (OP == DI_DIV)
+                 zero |= !((y1[i] > 0) & (y2[i] > 0)) & !((y1[i] < 0) & (y2[i] < 0));
+             DIBounds<T, OP>(x1[i], x2[i], y1[i], y2[i], loUp, hiUp);
+             bool outer = DIPickOuter(proper, dint, loDn[i], hiUp, loUp, hiDn[i]);
+             ra[start + i] = outer ? loDn[i] : loUp;
+             rb[start + i] = outer ? hiUp : hiDn[i];
+         }
+     }
+     SetRounding<T>(FE_TONEAREST);
+     if (zero)
+         throw runtime_error("Division by an interval containing 0.");
+ }
+ 
+ template<typename T, DIOperation OP>
+ inline void DIBatch(const IntervalArray<T> &x, const IntervalArray<T> &y,
+         IntervalArray<T> &r) {
+     if (x.size() != y.size())
+         throw runtime_error("Tablice przedziałów mają różne długości.");
+     r.resize(x.size());
+     DIBatch<T, OP>(x.a.data(), x.b.data(), y.a.data(), y.b.data(), r.a.data(),
+             r.b.data(), x.size());
+ }
+ 
+ template<typename T>
+ void DIAddBatch(const IntervalArray<T> &x, const IntervalArray<T> &y,
+         IntervalArray<T> &r) {
+     DIBatch<T, DI_ADD>(x, y, r);
+ }
+ 
+ template<typename T>
+ void DISubBatch(const IntervalArray<T> &x, const IntervalArray<T> &y,
+         IntervalArray<T> &r) {
+     DIBatch<T, DI_SUB>(x, y, r);
+ }
+ 
+ template<typename T>
+ void DIMulBatch(const IntervalArray<T> &x, const IntervalArray<T> &y,
+         IntervalArray<T> &r) {
+     DIBatch<T, DI_MUL>(x, y, r);
+ }
+ 
+ // Jak DIDiv: gdy któryś y zawiera 0, po przeliczeniu całej paczki zgłaszany jest wyjątek
+ template<typename T>
+ void DIDivBatch(const IntervalArray<T> &x, const IntervalArray<T> &y,
+         IntervalArray<T> &r) {
+     DIBatch<T, DI_DIV>(x, y, r);
+ }
+ 
+ // ------------------------------------------------------------------------------------
+ // Przedziały w postaci środek-promień: x = <mid, rad> = [mid - rad, mid + rad].
+ // Działania MRAdd/MRSub/MRMul/MRDiv wymagają trybu FE_UPWARD ustawionego przez
+ // wywołującego: środek liczony jest tak jak wypada (błąd zaokrąglenia w dowolnym
+ // kierunku nie przekracza eps*|mid|, plus najmniejsza liczba subnormalna przy
+ // niedomiarze iloczynu/ilorazu), a promień jest sumą nieujemnych składników, więc
+ // zaokrąglenie w górę daje jego górne ograniczenie. Cała pętla działań wymaga zatem
+ // jednej zmiany trybu, a nie dwóch na każde działanie, jak w postaci [a, b].
+ 
+ template<typename T>
+ struct MidRadInterval {
+     T mid;
+     T rad;
+ };
+ 
+ template<typename T>
+ inline T MidRadEpsilon() {
+     return std::numeric_limits<T>::epsilon();
+ }
+ 
+ template<typename T>
+ inline T MidRadEta() {
+     return std::numeric_limits<T>::denorm_min();
+ }
+ 
+ template<typename T>
+ inline MidRadInterval<T> MRFromInterval(const Interval<T> &x) {
+     MidRadInterval<T> r;
+     r.mid = x.a / 2 + x.b / 2;
+     SetRounding<T>(FE_UPWARD);
+     r.rad = KMax(r.mid - x.a, x.b - r.mid);
+     SetRounding<T>(FE_TONEAREST);
+     return r;
+ }
+ 
+ template<typename T>
+ inline Interval<T> MRToInterval(const MidRadInterval<T> &x) {
+     Interval<T> r;
+     SetRounding<T>(FE_DOWNWARD);
+     r.a = x.mid - x.rad;
+     SetRounding<T>(FE_UPWARD);
+     r.b = x.mid + x.rad;
+     SetRounding<T>(FE_TONEAREST);
+     return r;
+ }
+ 
+ // Suma i różnica – błąd środka jest zerowy przy niedomiarze, więc bez składnika eta
+ template<typename T>
+ inline MidRadInterval<T> MRAdd(const MidRadInterval<T> &x, const MidRadInterval<T> &y) {
+     MidRadInterval<T> r;
+     r.mid = x.mid + y.mid;
+     r.rad = MidRadEpsilon<T>() * abs(r.mid) + x.rad + y.rad;
+     return r;
+ }
+ 
+ template<typename T>
+ inline MidRadInterval<T> MRSub(const MidRadInterval<T> &x, const MidRadInterval<T> &y) {
+     MidRadInterval<T> r;
+     r.mid = x.mid - y.mid;
+     r.rad = MidRadEpsilon<T>() * abs(r.mid) + x.rad + y.rad;
+     return r;
+ }
+ 
+ // |x*y - mx*my| <= (|mx| + rx)*ry + rx*|my|
+ template<typename T>
+ inline MidRadInterval<T> MRMul(const MidRadInterval<T> &x, const MidRadInterval<T> &y) {
+     MidRadInterval<T> r;
+     r.mid = x.mid * y.mid;
+     r.rad = MidRadEpsilon<T>() * abs(r.mid) + MidRadEta<T>()
+             + (abs(x.mid) + x.rad) * y.rad + x.rad * abs(y.mid);
+     return r;
+ }
+ 
+ // |x/y - mx/my| <= (rx*|my| + |mx|*ry) / (|my| * (|my| - ry)); mianownik zaokrąglamy
+ // w dół jako -((-|my|) * (ry - |my|)), bo w FE_UPWARD -u jest zaokrąglone w górę
+ template<typename T>
+ inline MidRadInterval<T> MRDiv(const MidRadInterval<T> &x, const MidRadInterval<T> &y) {
+     T ym = abs(y.mid);
+     T gapNeg = y.rad - ym;
+     if (!(gapNeg < 0))
+         throw runtime_error("Division by an interval containing 0.");
+     T den = -(-ym * -gapNeg);
+     MidRadInterval<T> r;
+     r.mid = x.mid / y.mid;
+     r.rad = MidRadEpsilon<T>() * abs(r.mid) + MidRadEta<T>()
+             + (x.rad * ym + abs(x.mid) * y.rad) / den;
+     return r;
+ }
+ 
+ // Iloczyn przez stałą dokładnie reprezentowalną
+ template<typename T>
+ inline MidRadInterval<T> MRScale(const MidRadInterval<T> &x, T c) {
+     MidRadInterval<T> r;
+     r.mid = c * x.mid;
+     r.rad = MidRadEpsilon<T>() * abs(r.mid) + MidRadEta<T>() + abs(c) * x.rad;
+     return r;
+ }
+ 
  template<typename T>
  Interval<T> DISin(const Interval<T> &x) {
      bool is_even, finished;
@@ -1622,6 +2768,247 @@
      }
  }
  
+ // ------------------------------------------------------------------------------------
+ // Wyrażenia odroczone (expression templates) na przedziałach właściwych. ILazy(x) owija
+ // przedział, a +, -, *, / (także ze stałą typu T) budują drzewo bez obliczeń; IEval
+ // liczy całe wyrażenie przy jednym trybie FE_UPWARD. Dolny koniec każdego węzła jest
+ // przechowywany jako -lo: -((-u) * v) zaokrąglone w górę to u * v zaokrąglone w dół,
+ // więc oba końce liczone są w tym samym trybie. Wyrażenie kosztuje dwie zmiany trybu
+ // zamiast trzech na każde działanie i nie tworzy pośrednich Interval<T>; końce są takie
+ // same jak z IAdd/ISub/IMul/IDiv (minimum i maksimum wybierane w tej samej kolejności).
+ // W trybie DINT_MODE (arytmetyka Kauchera nie ma tej postaci) i dla mpreal (zmiana trybu
+ // to tylko ustawienie domyślnego zaokrąglenia, a każda negacja kosztuje alokację) IEval
+ // liczy węzły po kolei funkcjami I*/DI*. Liście trzymają referencje – wyrażenie oblicza
+ // się w tej samej instrukcji, w której powstało.
+ 
+ // Negacja wchodząca do dalszych działań. Dla typów wbudowanych przez RoundBarrier (jak
+ // w MulDown): bez -frounding-math kompilator może zamienić (-x) * y na -(x * y), co
+ // odwraca kierunek zaokrąglenia. Działania MPFR dostają tryb jawnie – bariera zbędna.
+ template<typename T>
+ inline T IExprNeg(const T &x) {
+     if constexpr (std::is_floating_point<T>::value)
+         return RoundBarrier(-x);
+     else
+         return -x;
+ }
+ 
+ template<typename E>
+ struct IExpr {
+     const E &Self() const {
+         return static_cast<const E &>(*this);
+     }
+ };
+ 
+ template<typename T>
+ struct IExprLeaf: IExpr<IExprLeaf<T> > {
+     typedef T Value;
+     const Interval<T> &x;
+ 
+     explicit IExprLeaf(const Interval<T> &v) :
+             x(v) {
+     }
+     // n = -lo, u = hi
+     void Bounds(T &n, T &u) const {
+         n = IExprNeg(x.a);
+         u = x.b;
+     }
+     const Interval<T> &Eager() const {
+         return x;
+     }
+ };
+ 
+ template<typename T>
+ struct IExprConst: IExpr<IExprConst<T> > {
+     typedef T Value;
+     T c;
+ 
+     explicit IExprConst(const T &v) :
+             c(v) {
+     }
+     void Bounds(T &n, T &u) const {
+         n = IExprNeg(c);
+         u = c;
+     }
+     Interval<T> Eager() const {
+         return Interval<T>(c, c);
+     }
+ };
+ 
+ template<typename T, DIOperation OP>
+ inline T IExprApply(const T &u, const T &v) {
+     if constexpr (OP == DI_MUL)
+         return u * v;
+     else
+         return u / v;
+ }
+ 
+ // Iloczyn/iloraz w FE_UPWARD: u = max(x op y), n = max((-x) op y) = -min(x op y).
+ // Kolejność jak w IMul/IDiv: x.b op y.b, x.b op y.a, x.a op y.b, x.a op y.a.
+ template<typename T, DIOperation OP>
+ inline void IExprCorners(const T &xl, const T &xh, const T &yl, const T &yh, T &n, T &u) {
+     T nxl = IExprNeg(xl), nxh = IExprNeg(xh), p;
+     n = IExprApply<T, OP>(nxh, yh);
+     u = IExprApply<T, OP>(xh, yh);
+     p = IExprApply<T, OP>(nxh, yl);
+     if (p > n)
+         n = p;
+     p = IExprApply<T, OP>(nxl, yh);
+     if (p > n)
+         n = p;
+     p = IExprApply<T, OP>(nxl, yl);
+     if (p > n)
+         n = p;
+     p = IExprApply<T, OP>(xh, yl);
+     if (p > u)
+         u = p;
+     p = IExprApply<T, OP>(xl, yh);
+     if (p > u)
+         u = p;
+     p = IExprApply<T, OP>(xl, yl);
+     if (p > u)
+         u = p;
+ }
+ 
+ template<typename L, typename R, DIOperation OP>
+ struct IExprBinary: IExpr<IExprBinary<L, R, OP> > {
+     typedef typename L::Value Value;
+     L l;
+     R r;
+ 
+     IExprBinary(const L &left, const R &right) :
+             l(left), r(right) {
+     }
+     void Bounds(Value &n, Value &u) const {
+         Value ln, lu, rn, ru;
+         l.Bounds(ln, lu);
+         r.Bounds(rn, ru);
+         if constexpr (OP == DI_ADD) {
+             n = ln + rn;
+             u = lu + ru;
+         } else if constexpr (OP == DI_SUB) {
+             n = ln + ru;
+             u = lu + rn;
+         } else {
+             Value xl = IExprNeg(ln), yl = IExprNeg(rn);
+             if constexpr (OP == DI_DIV)
+                 if ((yl <= 0) && (ru >= 0))
+                     throw runtime_error("Division by an interval containing 0.");
+             IExprCorners<Value, OP>(xl, lu, yl, ru, n, u);
+         }
+     }
+     // Obliczenie działanie po działaniu, jak operatory Interval<T>
+     Interval<Value> Eager() const {
+         bool dint = Interval<Value>::GetMode() == DINT_MODE;
+         if constexpr (OP == DI_ADD)
+             return dint ? DIAdd(l.Eager(), r.Eager()) : IAdd(l.Eager(), r.Eager());
+         else if constexpr (OP == DI_SUB)
+             return dint ? DISub(l.Eager(), r.Eager()) : ISub(l.Eager(), r.Eager());
+         else if constexpr (OP == DI_MUL)
+             return dint ? DIMul(l.Eager(), r.Eager()) : IMul(l.Eager(), r.Eager());
+         else
+             return dint ? DIDiv(l.Eager(), r.Eager()) : IDiv(l.Eager(), r.Eager());
+     }
+ };
+ 
+ template<typename T>
+ inline IExprLeaf<T> ILazy(const Interval<T> &x) {
+     return IExprLeaf<T>(x);
+ }
+ 
+ template<typename A, typename B>
+ inline IExprBinary<A, B, DI_ADD> operator +(const IExpr<A> &a, const IExpr<B> &b) {
+     return IExprBinary<A, B, DI_ADD>(a.Self(), b.Self());
+ }
+ 
+ template<typename A, typename B>
+ inline IExprBinary<A, B, DI_SUB> operator -(const IExpr<A> &a, const IExpr<B> &b) {
+     return IExprBinary<A, B, DI_SUB>(a.Self(), b.Self());
+ }
+ 
+ template<typename A, typename B>
+ inline IExprBinary<A, B, DI_MUL> operator *(const IExpr<A> &a, const IExpr<B> &b) {
+     return IExprBinary<A, B, DI_MUL>(a.Self(), b.Self());
+ }
+ 
+ template<typename A, typename B>
+ inline IExprBinary<A, B, DI_DIV> operator /(const IExpr<A> &a, const IExpr<B> &b) {
+     return IExprBinary<A, B, DI_DIV>(a.Self(), b.Self());
+ }
+ 
+ // Stała c działa jak przedział [c, c] (jak w operator *(int, Interval<T>))
+ template<typename B>
+ inline IExprBinary<IExprConst<typename B::Value>, B, DI_MUL> operator *(
+         const typename B::Value &c, const IExpr<B> &b) {
+     typedef IExprConst<typename B::Value> C;
+     return IExprBinary<C, B, DI_MUL>(C(c), b.Self());
+ }
+ 
+ template<typename A>
+ inline IExprBinary<A, IExprConst<typename A::Value>, DI_MUL> operator *(
+         const IExpr<A> &a, const typename A::Value &c) {
+     typedef IExprConst<typename A::Value> C;
+     return IExprBinary<A, C, DI_MUL>(a.Self(), C(c));
+ }
+ 
+ template<typename A>
+ inline IExprBinary<A, IExprConst<typename A::Value>, DI_DIV> operator /(
+         const IExpr<A> &a, const typename A::Value &c) {
+     typedef IExprConst<typename A::Value> C;
+     return IExprBinary<A, C, DI_DIV>(a.Self(), C(c));
+ }
+ 
+ // Obliczenie wyrażenia przy FE_UPWARD ustawionym już przez RoundingScope – bez zmian trybu,
+ // do pętli po tablicach. Dla mpreal i w DINT_MODE działanie po działaniu (funkcje I*/DI*
+ // same ustawiają tryb), więc wynik jest poprawny także wtedy.
+ template<typename E>
+ inline Interval<typename E::Value> IEvalScoped(const IExpr<E> &e) {
+     typedef typename E::Value T;
+     if (!std::is_floating_point<T>::value || Interval<T>::GetMode() == DINT_MODE)
+         return e.Self().Eager();
+     T n, u;
+     e.Self().Bounds(n, u);
+     return Interval<T>(-n, u);
+ }
+ 
+ // Pojedyncze wyrażenie z własnym zakresem FE_UPWARD. Bariera jak w DIRoundingFence: drzewo
+ // (z jego stałymi) jest czytane dopiero po ustawieniu trybu, a wynik jest gotowy przed
+ // przywróceniem poprzedniego.
+ template<typename E>
+ inline Interval<typename E::Value> IEval(const IExpr<E> &e) {
+     typedef typename E::Value T;
+     if (!std::is_floating_point<T>::value || Interval<T>::GetMode() == DINT_MODE)
+         return e.Self().Eager();
+     RoundingScope<T> up(FE_UPWARD);
+ #if defined(__GNUC__)
+     __asm__ volatile("" : : "r"(&e) : "memory");
+ #endif
+     Interval<T> r = IEvalScoped(e);
+     DIRoundingFence(&r.a, &r.b);
+     return r;
+ }
+ 
+ // Działania przy FE_UPWARD ustawionym przez RoundingScope<T>(FE_UPWARD); końce takie same
+ // jak z IAdd/ISub/IMul/IDiv (w DINT_MODE – jak z operatorów)
+ template<typename T>
+ inline Interval<T> IAddScoped(const Interval<T> &x, const Interval<T> &y) {
+     return IEvalScoped(ILazy(x) + ILazy(y));
+ }
+ 
+ template<typename T>
+ inline Interval<T> ISubScoped(const Interval<T> &x, const Interval<T> &y) {
+     return IEvalScoped(ILazy(x) - ILazy(y));
+ }
+ 
+ template<typename T>
+ inline Interval<T> IMulScoped(const Interval<T> &x, const Interval<T> &y) {
+     return IEvalScoped(ILazy(x) * ILazy(y));
+ }
+ 
+ template<typename T>
+ inline Interval<T> IDivScoped(const Interval<T> &x, const Interval<T> &y) {
+     return IEvalScoped(ILazy(x) / ILazy(y));
+ }
+ 
  template<typename T>
  Interval<T> Hull(const Interval<T> &x, const Interval<T> &y) {
      Interval<T> r = { 0, 0 };
@@ -1638,35 +3025,8 @@
  
  template<>
  inline void Interval<mpreal>::IEndsToStrings(string &left, string &right) {
-     mpfr_t rop;
-     mpfr_exp_t exponent;
-     mpfr_init2(rop, precision);
-     char *str = NULL;
-     char *buffer = new char(precision + 3);
-     mpfr_set(rop, this->a.mpfr_ptr(), MPFR_RNDD);
-     mpfr_get_str(buffer, &exponent, 10, outdigits, rop, MPFR_RNDD);
-     str = buffer;
- 
-     stringstream ss;
-     int prec = std::numeric_limits<mpreal>::digits10();
-     ss.setf(std::ios_base::scientific);
-     bool minus = (str[0] == '-');
-     int splitpoint = minus ? 1 : 0;
-     string sign = minus ? "-" : "";
- 
-     ss << std::setprecision(prec) << sign << str[splitpoint] << "."
-             << &str[splitpoint + 1] << "E" << exponent - 1;
-     left = ss.str();
-     ss.str(std::string());
- 
-     mpfr_set(rop, this->b.mpfr_ptr(), MPFR_RNDU);
-     mpfr_get_str(buffer, &exponent, 10, outdigits, rop, MPFR_RNDU);
-     str = buffer;
-     splitpoint = (str[0] == '-') ? 1 : 0;
-     ss << std::setprecision(prec) << sign << str[splitpoint] << "."
-             << &str[splitpoint + 1] << "E" << exponent - 1;
-     right = ss.str();
-     ss.clear();
+     FormatMpfrEnd(left, this->a.mpfr_srcptr(), MPFR_RNDD, outdigits);
+     FormatMpfrEnd(right, this->b.mpfr_srcptr(), MPFR_RNDU, outdigits);
  }
  
  template<>
@@ -1727,15 +3087,15 @@
  template class Interval<float> ;
  template class Interval<mpreal> ;
  
- template<typename T> IAMode Interval<T>::mode = PINT_MODE;
- template<typename T> IAOutDigits Interval<T>::outdigits = LONGDOUBLE_DIGITS;
+ template<typename T> thread_local IAMode Interval<T>::mode = PINT_MODE;
+ template<typename T> thread_local IAOutDigits Interval<T>::outdigits = LONGDOUBLE_DIGITS;
  
  //template<> IAPrecision Interval<long double>::precision = LONGDOUBLE_PREC;
  //template<> IAPrecision Interval<double>::precision = DOUBLE_PREC;
  //template<> IAPrecision Interval<float>::precision = FLOAT_PREC;
  
- template<> IAPrecision Interval<mpreal>::precision = MPREAL_PREC;
- template<typename T> IAPrecision Interval<T>::precision = LONGDOUBLE_PREC;
+ template<> thread_local IAPrecision Interval<mpreal>::precision = MPREAL_PREC;
+ template<typename T> thread_local IAPrecision Interval<T>::precision = LONGDOUBLE_PREC;
  //template IAOutDigits Interval<mpreal>::outdigits = LONGDOUBLE_DIGITS;
  
  //-------------------------------------------------------------------------------------
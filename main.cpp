@@ -16,6 +16,12 @@
 #include <cfenv>
 #include <mpfr.h>
 #include <fenv.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <exception>
+#include <array>
 #include "interval.h"
 using namespace std;
 
@@ -24,14 +30,13 @@ struct Interval {
 };
 
 // Funkcja do wczytania przedziału z pojedynczego ciągu znaków
+// (zmienna MPFR pochodzi z MpfrScratch – bez mpfr_init2/mpfr_clear przy każdej wartości)
 Interval IntRead(const string& sa) {
-    mpfr_t rop;
-    mpfr_init2(rop, 113); // 113 bitów precyzji dla __float128
+    mpfr_ptr rop = interval_arithmetic::MpfrScratch::Get(0, 113); // 113 bitów precyzji dla __float128
     mpfr_set_str(rop, sa.c_str(), 10, MPFR_RNDD);
     __float128 le = mpfr_get_ld(rop, MPFR_RNDD);
     mpfr_set_str(rop, sa.c_str(), 10, MPFR_RNDU);
     __float128 re = mpfr_get_ld(rop, MPFR_RNDU);
-    mpfr_clear(rop);
     Interval r;
     r.lo = le;
     r.hi = re;
@@ -39,42 +44,281 @@ Interval IntRead(const string& sa) {
 }
 
 __float128 LeftRead(const string& sa) {
-    mpfr_t rop;
-    mpfr_init2(rop, 113);
+    mpfr_ptr rop = interval_arithmetic::MpfrScratch::Get(0, 113);
     mpfr_set_str(rop, sa.c_str(), 10, MPFR_RNDD);
-    __float128 le = mpfr_get_ld(rop, MPFR_RNDD);
-    mpfr_clear(rop);
-    return le;
+    return mpfr_get_ld(rop, MPFR_RNDD);
 }
 
 // Funkcja do wczytania górnej granicy z zaokrąglaniem w górę
 __float128 RightRead(const string& sa) {
-    mpfr_t rop;
-    mpfr_init2(rop, 113);
+    mpfr_ptr rop = interval_arithmetic::MpfrScratch::Get(0, 113);
     mpfr_set_str(rop, sa.c_str(), 10, MPFR_RNDU);
-    __float128 re = mpfr_get_ld(rop, MPFR_RNDU);
-    mpfr_clear(rop);
-    return re;
+    return mpfr_get_ld(rop, MPFR_RNDU);
 }
 
 __float128 IntWidth(const Interval &x) {
     return x.hi - x.lo;
 }
+// Odpowiednik mpfr_sprintf(out, "%.18Re", v) – mpfr_sprintf przydziela wewnętrzne bufory
+// przy każdym wywołaniu, mpfr_get_str pisze do podanego bufora
+static void formatSci18(char *out, size_t size, mpfr_srcptr v) {
+    if (!mpfr_number_p(v)) {
+        mpfr_snprintf(out, size, "%.18Re", v);
+        return;
+    }
+    char digits[32];
+    mpfr_exp_t exponent;
+    mpfr_get_str(digits, &exponent, 10, 19, v, MPFR_RNDN);
+    bool minus = (digits[0] == '-');
+    const char *d = digits + (minus ? 1 : 0);
+    if (mpfr_zero_p(v)) exponent = 1;
+    snprintf(out, size, "%s%c.%se%+03ld", minus ? "-" : "", d[0], d + 1, (long) (exponent - 1));
+}
+
 void IEndsToString(const Interval& a, std::ostream& os = std::cout) {
-    mpfr_t lo, hi;
-    mpfr_init2(lo, 113);
-    mpfr_init2(hi, 113);
+    mpfr_ptr lo = interval_arithmetic::MpfrScratch::Get(0, 113);
+    mpfr_ptr hi = interval_arithmetic::MpfrScratch::Get(1, 113);
     mpfr_set_ld(lo, a.lo, MPFR_RNDN);
     mpfr_set_ld(hi, a.hi, MPFR_RNDN);
 
     char lo_str[64], hi_str[64];
-    mpfr_sprintf(lo_str, "%.18Re", lo); // notacja naukowa
-    mpfr_sprintf(hi_str, "%.18Re", hi);
+    formatSci18(lo_str, sizeof(lo_str), lo); // notacja naukowa
+    formatSci18(hi_str, sizeof(hi_str), hi);
 
     os << "[" << lo_str << ", " << hi_str << "]";
+}
+
+// ====================
+// Indeks wyszukiwania segmentu
+// ====================
+// Węzły w układzie Eytzingera (kopiec BFS: dzieci k to 2k i 2k+1), więc kolejne poziomy
+// wyszukiwania leżą obok siebie w pamięci, a pętla nie ma rozgałęzień zależnych od danych.
+// Wyszukiwanie idzie po kluczach double (zaokrąglenie jest monotoniczne), a wynik
+// poprawiamy dokładnym porównaniem __float128 – korekta dotyczy tylko węzłów, które
+// w double są równe szukanej wartości.
+class KnotIndex {
+private:
+    size_t n = 0;
+    vector<__float128> keys;          // węzły w kolejności rosnącej
+    vector<double> tree;              // tree[1..n], tree[0] nieużywane
+    vector<uint32_t> rank;            // rank[k] – pozycja tree[k] w kolejności rosnącej
+    double *treeData = nullptr;       // początek tree wyrównany do linii pamięci podręcznej
+    bool uniform = false;             // węzły w przybliżeniu równoodległe – indeks liczony wprost
+    double origin = 0.0, invStep = 0.0;
+
+    // Siatka jest traktowana jako równomierna, gdy każdy węzeł leży w odległości co najwyżej
+    // h/4 od x[0] + i*h, a h jest rozróżnialne w double względem wartości węzłów. Wtedy
+    // floor((q - x[0])/h) myli się co najwyżej o jeden segment i wystarcza jeden krok korekty.
+    bool detectUniform() {
+        if (n < 2)
+            return false;
+        double x0 = (double) keys[0];
+        double step = (double) ((keys[n - 1] - keys[0]) / (__float128) (n - 1));
+        double scale = fmax(fabs(x0), fabs((double) keys[n - 1]));
+        if (!(step > 0) || !(scale < step * 0x1p40))
+            return false;
+        for (size_t i = 0; i < n; i++)
+            if (!(fabs((double) keys[i] - (x0 + (double) i * step)) <= step / 4))
+                return false;
+        origin = x0;
+        invStep = 1.0 / step;
+        return true;
+    }
+
+    size_t fill(size_t i, size_t k) {
+        if (k <= n) {
+            i = fill(i, 2 * k);
+            treeData[k] = (double) keys[i];
+            rank[k] = (uint32_t) i;
+            i++;
+            i = fill(i, 2 * k + 1);
+        }
+        return i;
+    }
+
+public:
+    KnotIndex() {
+    }
+
+    explicit KnotIndex(const vector<__float128> &sorted) {
+        build(sorted);
+    }
+
+    KnotIndex(const KnotIndex &other) {
+        *this = other;
+    }
+
+    KnotIndex &operator=(const KnotIndex &other) {
+        if (this != &other)
+            build(other.keys);
+        return *this;
+    }
+
+    void build(const vector<__float128> &sorted) {
+        keys = sorted;
+        n = keys.size();
+        uniform = detectUniform();
+        if (uniform) {
+            tree.clear();
+            rank.clear();
+            treeData = nullptr;
+            return;
+        }
+        // 8 double na linię 64 B: prefetch tree[8k] pobiera całą linię z potomkami k
+        // trzy poziomy niżej, jeśli tree[0] leży na początku linii
+        tree.assign(n + 1 + 8, 0.0);
+        uintptr_t base = reinterpret_cast<uintptr_t>(tree.data());
+        treeData = reinterpret_cast<double *>((base + 63) & ~uintptr_t(63));
+        if (treeData + n + 1 > tree.data() + tree.size()) {
+            tree.resize(n + 1 + 16);
+            base = reinterpret_cast<uintptr_t>(tree.data());
+            treeData = reinterpret_cast<double *>((base + 63) & ~uintptr_t(63));
+        }
+        rank.assign(n + 1, 0);
+        fill(0, 1);
+    }
+
+    size_t size() const {
+        return n;
+    }
+
+    // Liczba węzłów <= q (odpowiednik std::upper_bound)
+    size_t upperBound(__float128 q) const {
+        if (uniform)
+            return uniformUpperBound(q);
+        double qd = (double) q;
+        size_t k = 1;
+        while (k <= n) {
+            __builtin_prefetch(treeData + 8 * k);
+            k = 2 * k + (treeData[k] <= qd);
+        }
+        // Cofamy się do ostatniego skrętu w lewo – to pierwszy węzeł > qd
+        k >>= __builtin_ffsll(~(long long) k);
+        size_t count = k == 0 ? n : rank[k];
+        if (count == 0 || keys[count - 1] <= q)
+            return count;
+        // Węzły równe qd w double, ale większe od q – zwykle jeden; dla długiej serii takich
+        // węzłów szukamy wykładniczo wstecz, a potem binarnie
+        size_t step = 1, hiPos = count - 1;
+        while (step < count && keys[count - 1 - step] > q) {
+            hiPos = count - 1 - step;
+            step *= 2;
+        }
+        size_t loPos = step < count ? count - 1 - step : 0;
+        return upper_bound(keys.begin() + loPos, keys.begin() + hiPos, q) - keys.begin();
+    }
+
+    // Siatka równomierna: indeks z floor((q - x[0])/h), poprawiony dokładnym porównaniem
+    size_t uniformUpperBound(__float128 q) const {
+        double t = ((double) q - origin) * invStep;
+        size_t count = 0;
+        if (t >= (double) n)
+            count = n;
+        else if (t >= 0)
+            count = (size_t) t + 1;
+        while (count < n && keys[count] <= q)
+            count++;
+        while (count > 0 && keys[count - 1] > q)
+            count--;
+        return count;
+    }
+
+    bool isUniform() const {
+        return uniform;
+    }
+
+    // Segment splajnu dla punktu: x[i] <= q < x[i+1], poza zakresem skrajny segment
+    int segment(__float128 q) const {
+        long i = (long) upperBound(q) - 1;
+        return (int) max(0L, min(i, (long) n - 2));
+    }
+};
+
+// Indeks dla węzłów przedziałowych – ten sam wybór segmentu co dotychczasowa pętla:
+// pierwszy i z x[i].lo <= xi.lo oraz xi.hi < x[i+1].hi (0, gdy takiego nie ma). Węzły
+// nie zachodzą na siebie, więc lewe i prawe końce są rosnące: pierwszy warunek spełniają
+// i < ubLo, a drugi i >= ubHi - 1, gdzie ub to liczba końców <= xi.lo (xi.hi).
+class IntervalKnotIndex {
+private:
+    KnotIndex lo, hi;
+    __float128 first = 0.0Q, last = 0.0Q;
+
+public:
+    IntervalKnotIndex() {
+    }
+
+    explicit IntervalKnotIndex(const vector<Interval> &x) {
+        build(x);
+    }
 
-    mpfr_clear(lo);
-    mpfr_clear(hi);
+    void build(const vector<Interval> &x) {
+        vector<__float128> l(x.size()), h(x.size());
+        for (size_t i = 0; i < x.size(); i++) {
+            l[i] = x[i].lo;
+            h[i] = x[i].hi;
+        }
+        lo.build(l);
+        hi.build(h);
+        if (!x.empty()) {
+            first = x.front().lo;
+            last = x.back().hi;
+        }
+    }
+
+    int segment(const Interval &xi) const {
+        if (xi.lo < first || xi.hi >= last)
+            return segmentFromCounts(xi, 0, 0);
+        return segmentFromCounts(xi, (long) lo.upperBound(xi.lo), (long) hi.upperBound(xi.hi));
+    }
+
+    // Wybór segmentu dla znanych liczb lewych (ubLo) i prawych (ubHi) końców <= xi.lo, xi.hi
+    // (kursor utrzymuje je sam, bez przeszukiwania indeksu)
+    int segmentFromCounts(const Interval &xi, long ubLo, long ubHi) const {
+        long n = (long) lo.size();
+        if (xi.lo < first)
+            return 0;
+        if (xi.hi >= last)
+            return (int) (n - 2);
+        long q = max(0L, ubHi - 1);
+        return q < ubLo ? (int) q : 0;
+    }
+};
+
+// ====================
+// Siatka równomierna
+// ====================
+// Dla h[i] = h układ splajnu naturalnego po podzieleniu przez h ma stałą macierz
+// tridiag(1, 4, 1): c[i-1] + 4*c[i] + c[i+1] = 6*(y[i+1] - 2*y[i] + y[i-1])/h^2.
+
+// Odwrotności piwotów eliminacji dla tridiag(1, 4, 1): l[0] = 4, l[i] = 4 - 1/l[i-1]
+// (mu[i] = 1/l[i], bo nad diagonalą stoją jedynki). Nie zależą od danych. Ciąg jest
+// niemalejący i ograniczony (granica 2 - sqrt(3)), więc po kilkudziesięciu wierszach
+// ustala się – zapisujemy tylko początek, a dalsze wiersze używają ostatniej wartości.
+// Zaokrąglenie ustawia wywołujący; l liczone jako -(inv - 4), żeby było zaokrąglone
+// przeciwnie do inv (jak w thomasMonotone).
+static void uniformPivots(vector<__float128> &inv) {
+    inv.assign(1, 1.0Q / 4.0Q);
+    while (true) {
+        __float128 next = 1.0Q / -(inv.back() - 4.0Q);
+        if (next == inv.back())
+            break;
+        inv.push_back(next);
+    }
+}
+
+// Czy węzły są równoodległe z dokładnością do zaokrąglenia danych wejściowych:
+// |x[i] - (x[0] + i*h)| <= 8*eps*max|x| dla h = (x[n-1] - x[0])/(n-1)
+static bool uniformGridStep(const __float128 *x, size_t n, __float128 &h) {
+    if (n < 3)
+        return false;
+    h = (x[n - 1] - x[0]) / (__float128) (n - 1);
+    __float128 tol = 8.0Q * FLT128_EPSILON * fmaxq(fabsq(x[0]), fabsq(x[n - 1]));
+    if (!(h > 0))
+        return false;
+    for (size_t i = 1; i < n - 1; i++)
+        if (!(fabsq(x[i] - (x[0] + (__float128) i * h)) <= tol))
+            return false;
+    return true;
 }
 
 // ====================
@@ -87,72 +331,949 @@ struct SplineSegment {
     __float128 a0, a1, a2, a3;
 };
 
+// Algorytm Thomasa dla macierzy punktowej (zaokrąglenie do najbliższej)
+static void thomasSolve(const vector<__float128> &sub, const vector<__float128> &diag,
+                        const vector<__float128> &sup, const vector<__float128> &rhs,
+                        vector<__float128> &x) {
+    size_t m = diag.size();
+    vector<__float128> mu(m), z(m);
+    __float128 l = diag[0];
+    mu[0] = sup[0] / l;
+    z[0] = rhs[0] / l;
+    for (size_t i = 1; i < m; i++) {
+        l = diag[i] - sub[i] * mu[i - 1];
+        mu[i] = sup[i] / l;
+        z[i] = (rhs[i] - sub[i] * z[i - 1]) / l;
+    }
+    x.resize(m);
+    x[m - 1] = z[m - 1];
+    for (size_t i = m - 1; i-- > 0;)
+        x[i] = z[i] - mu[i] * x[i + 1];
+}
+
+// Układ cykliczny: jak w thomasSolve, ale sub[0] stoi w kolumnie m-1, a sup[m-1]
+// w kolumnie 0. Wzór Shermana-Morrisona: A = T + u*v^T, gdzie T to część trójdiagonalna ze
+// zmienioną diagonalą, u = (gamma, 0, ..., 0, sup[m-1]), v = (1, 0, ..., 0, sub[0]/gamma).
+// Rozwiązanie x = T^-1*rhs - z*(v·T^-1*rhs)/(1 + v·z), z = T^-1*u – dwie prawe strony
+// i jedna faktoryzacja, więc O(m).
+static void cyclicSolve(const vector<__float128> &sub, const vector<__float128> &diag,
+                        const vector<__float128> &sup, const vector<__float128> &rhs,
+                        vector<__float128> &x) {
+    size_t m = diag.size();
+    if (m <= 2) {
+        // Narożniki pokrywają się z częścią trójdiagonalną (m = 1: wszystko na diagonali)
+        if (m == 1) {
+            x.assign(1, rhs[0] / (diag[0] + sub[0] + sup[0]));
+            return;
+        }
+        vector<__float128> s2 = {0.0Q, sub[1] + sup[1]}, p2 = {sup[0] + sub[0], 0.0Q};
+        thomasSolve(s2, diag, p2, rhs, x);
+        return;
+    }
+    __float128 alpha = sup[m - 1], beta = sub[0], gamma = -diag[0];
+    vector<__float128> mu(m), w(m), z(m);
+    for (size_t i = 0; i < m; i++) {
+        __float128 d = diag[i];
+        if (i == 0) d -= gamma;
+        if (i == m - 1) d -= alpha * beta / gamma;
+        __float128 l = i > 0 ? d - sub[i] * mu[i - 1] : d;
+        mu[i] = sup[i] / l;
+        __float128 u = i == 0 ? gamma : i == m - 1 ? alpha : 0.0Q;
+        w[i] = (i > 0 ? rhs[i] - sub[i] * w[i - 1] : rhs[i]) / l;
+        z[i] = (i > 0 ? u - sub[i] * z[i - 1] : u) / l;
+    }
+    for (size_t i = m - 1; i-- > 0;) {
+        w[i] -= mu[i] * w[i + 1];
+        z[i] -= mu[i] * z[i + 1];
+    }
+    __float128 fact = (w[0] + beta * w[m - 1] / gamma) / (1.0Q + z[0] + beta * z[m - 1] / gamma);
+    x.resize(m);
+    for (size_t i = 0; i < m; i++)
+        x[i] = w[i] - fact * z[i];
+}
+
+// Warunki brzegowe splajnu: naturalny (S'' = 0 na końcach), zamocowany (zadane S' na
+// końcach), not-a-knot (S''' ciągła w x[1] i x[n-2]) i okresowy (y[n-1] = y[0], S' i S''
+// równe na obu końcach)
+enum SplineBoundaryKind {
+    BOUNDARY_NATURAL, BOUNDARY_CLAMPED, BOUNDARY_NOT_A_KNOT, BOUNDARY_PERIODIC
+};
+
+template<typename T>
+struct SplineBoundary {
+    SplineBoundaryKind kind = BOUNDARY_NATURAL;
+    T startSlope{}, endSlope{};        // S'(x[0]) i S'(x[n-1]) dla BOUNDARY_CLAMPED
+};
+
+// Wektory pomocnicze dopasowania – jeden obszar roboczy może obsłużyć wiele splajnów
+// po kolei bez ponownych alokacji
+struct SplineWorkspace {
+    vector<__float128> mu, z, c, b, d;
+    vector<__float128> inv;            // piwoty uniformPivots (w zaokrągleniu do najbliższej)
+};
+
+// Współczynniki siatki równomiernej o kroku step: stałe piwoty, bez dzieleń w pętlach
+static void solveUniform(const __float128 *y, int n, __float128 step, SplineWorkspace &ws) {
+    int m = n - 2;
+    if (ws.inv.empty())
+        uniformPivots(ws.inv);
+    const vector<__float128> &inv = ws.inv;
+    vector<__float128> &z = ws.z, &c = ws.c, &b = ws.b, &d = ws.d;
+    int last = inv.size() - 1;
+    __float128 scale = 6.0Q / (step * step), invStep = 1.0Q / step;
+    __float128 step6 = step / 6.0Q, invStep6 = 1.0Q / (6.0Q * step);
+    for (int k = 0; k < m; k++) {
+        __float128 r = scale * (y[k + 2] - 2.0Q * y[k + 1] + y[k]);
+        if (k > 0) r -= z[k - 1];
+        z[k] = r * inv[min(k, last)];
+    }
+    // Niewiadome c[1..n-2] odpowiadają wierszom k = 0..m-1; c[0] = c[n-1] = 0
+    for (int k = m - 1; k >= 0; k--)
+        c[k + 1] = z[k] - inv[min(k, last)] * c[k + 2];
+    for (int j = n - 2; j >= 0; j--) {
+        b[j] = (y[j + 1] - y[j]) * invStep - step6 * (c[j + 1] + 2.0Q * c[j]);
+        d[j] = (c[j + 1] - c[j]) * invStep6;
+    }
+}
+
+// Współczynniki c, b, d dla warunków brzegowych innych niż naturalne. Układ dla
+// c[i] = S''(x[i]) w węzłach wewnętrznych jest ten sam co dla splajnu naturalnego; zmieniają
+// się tylko pierwszy i ostatni wiersz:
+//  - zamocowany: niewiadome c[0..n-1], 2h[0]*c[0] + h[0]*c[1] = 6*(s[0] - S'(x[0])) i symetrycznie
+//    na końcu (s[i] – ilorazy różnicowe);
+//  - not-a-knot: d[0] = d[1] daje c[0] = ((h0+h1)*c[1] - h0*c[2])/h1; po wstawieniu do wiersza 1
+//    (h0 + 2h1)*c[1] + (h1 - h0)*c[2] = h1*r[1]/(h0 + h1), symetrycznie na końcu;
+//  - okresowy: niewiadome c[0..n-2] (c[n-1] = c[0]), wiersz 0 sprzężony z c[n-2] przez h[n-2] –
+//    układ cykliczny rozwiązywany w O(n) przez cyclicSolve.
+static void solveBoundary(const __float128 *x, const __float128 *y, int n,
+                          const SplineBoundary<__float128> &bc, SplineWorkspace &ws) {
+    vector<__float128> &c = ws.c, &b = ws.b, &d = ws.d;
+    vector<__float128> h(n - 1), slope(n - 1), sub, diag, sup, rhs, sol;
+    for (int i = 0; i < n - 1; i++) {
+        h[i] = x[i + 1] - x[i];
+        slope[i] = (y[i + 1] - y[i]) / h[i];
+    }
+    if (bc.kind == BOUNDARY_CLAMPED) {
+        sub.assign(n, 0.0Q); diag.assign(n, 0.0Q); sup.assign(n, 0.0Q); rhs.assign(n, 0.0Q);
+        diag[0] = 2.0Q * h[0];
+        sup[0] = h[0];
+        rhs[0] = 6.0Q * (slope[0] - bc.startSlope);
+        for (int i = 1; i < n - 1; i++) {
+            sub[i] = h[i - 1];
+            diag[i] = 2.0Q * (x[i + 1] - x[i - 1]);
+            sup[i] = h[i];
+            rhs[i] = 6.0Q * (slope[i] - slope[i - 1]);
+        }
+        sub[n - 1] = h[n - 2];
+        diag[n - 1] = 2.0Q * h[n - 2];
+        rhs[n - 1] = 6.0Q * (bc.endSlope - slope[n - 2]);
+        thomasSolve(sub, diag, sup, rhs, sol);
+        for (int i = 0; i < n; i++) c[i] = sol[i];
+    } else if (bc.kind == BOUNDARY_NOT_A_KNOT && n == 3) {
+        // Jedna parabola przez trzy punkty
+        __float128 c0 = 2.0Q * (slope[1] - slope[0]) / (x[2] - x[0]);
+        c[0] = c[1] = c[2] = c0;
+    } else if (bc.kind == BOUNDARY_NOT_A_KNOT && n >= 4) {
+        int m = n - 2;
+        sub.assign(m, 0.0Q); diag.assign(m, 0.0Q); sup.assign(m, 0.0Q); rhs.assign(m, 0.0Q);
+        for (int i = 1; i < n - 1; i++) {
+            sub[i - 1] = h[i - 1];
+            diag[i - 1] = 2.0Q * (x[i + 1] - x[i - 1]);
+            sup[i - 1] = h[i];
+            rhs[i - 1] = 6.0Q * (slope[i] - slope[i - 1]);
+        }
+        diag[0] = h[0] + 2.0Q * h[1];
+        sup[0] = h[1] - h[0];
+        rhs[0] = h[1] * rhs[0] / (h[0] + h[1]);
+        sub[m - 1] = h[n - 3] - h[n - 2];
+        diag[m - 1] = 2.0Q * h[n - 3] + h[n - 2];
+        rhs[m - 1] = h[n - 3] * rhs[m - 1] / (h[n - 3] + h[n - 2]);
+        thomasSolve(sub, diag, sup, rhs, sol);
+        for (int i = 1; i < n - 1; i++) c[i] = sol[i - 1];
+        c[0] = ((h[0] + h[1]) * c[1] - h[0] * c[2]) / h[1];
+        c[n - 1] = ((h[n - 3] + h[n - 2]) * c[n - 2] - h[n - 2] * c[n - 3]) / h[n - 3];
+    } else if (bc.kind == BOUNDARY_PERIODIC) {
+        if (y[n - 1] != y[0])
+            throw std::invalid_argument("Dla warunku okresowego y[n-1] musi być równe y[0]");
+        int m = n - 1;
+        sub.assign(m, 0.0Q); diag.assign(m, 0.0Q); sup.assign(m, 0.0Q); rhs.assign(m, 0.0Q);
+        for (int i = 0; i < m; i++) {
+            int prev = i > 0 ? i - 1 : m - 1;
+            sub[i] = h[prev];
+            diag[i] = 2.0Q * (h[prev] + h[i]);
+            sup[i] = h[i];
+            rhs[i] = 6.0Q * (slope[i] - slope[prev]);
+        }
+        cyclicSolve(sub, diag, sup, rhs, sol);
+        for (int i = 0; i < m; i++) c[i] = sol[i];
+        c[n - 1] = c[0];
+    }
+    for (int j = n - 2; j >= 0; j--) {
+        b[j] = slope[j] - h[j] * (c[j + 1] + 2.0Q * c[j]) / 6.0Q;
+        d[j] = (c[j + 1] - c[j]) / (6.0Q * h[j]);
+    }
+}
+
+// Postać globalna a0..a3 z lokalnej (a, b, c, d, x)
+static inline void globalForm(SplineSegment &s) {
+    __float128 xi = s.x;
+    s.a0 = s.a - s.b * xi + (s.c * xi * xi) / 2.0Q - s.d * xi * xi * xi;
+    s.a1 = s.b - s.c * xi + 3.0Q * s.d * xi * xi;
+    s.a2 = (s.c) / 2.0Q - 3.0Q * s.d * xi;
+    s.a3 = s.d;
+}
+
+// Segmenty seg[0..n-2] z wartości a[i] i współczynników c, b, d obszaru roboczego
+static void storeSegments(const __float128 *x, const __float128 *a, int n,
+                          const SplineWorkspace &ws, SplineSegment *seg) {
+    const vector<__float128> &c = ws.c, &b = ws.b, &d = ws.d;
+    for (int i = 0; i < n - 1; i++) {
+        seg[i].a = a[i];
+        seg[i].b = b[i];
+        seg[i].c = c[i]; // zachowujemy oryginalne c[i]
+        seg[i].d = d[i];
+        seg[i].x = x[i];
+        globalForm(seg[i]);
+    }
+}
+
+// Splajn dla węzłów x[0..n-1] (n >= 2): współczynniki zapisywane do seg[0..n-2].
+// uniformGrid – wywołujący deklaruje równe odstępy węzłów (bez tego są wykrywane); stały
+// układ siatki równomiernej dotyczy tylko warunków naturalnych.
+static void fitCubicSpline(const __float128 *x, const __float128 *y, int n,
+                           const SplineBoundary<__float128> &bc, bool uniformGrid,
+                           SplineWorkspace &ws, SplineSegment *seg) {
+    ws.c.assign(n, 0.0Q);
+    ws.b.assign(n - 1, 0.0Q);
+    ws.d.assign(n - 1, 0.0Q);
+    ws.mu.assign(n, 0.0Q);
+    ws.z.assign(n, 0.0Q);
+    vector<__float128> &c = ws.c, &b = ws.b, &d = ws.d, &mu = ws.mu, &z = ws.z;
+    __float128 step = 0.0Q;
+    if (bc.kind != BOUNDARY_NATURAL) {
+        solveBoundary(x, y, n, bc, ws);
+    } else if (uniformGrid && n >= 3) {
+        step = (x[n - 1] - x[0]) / (__float128) (n - 1);
+        solveUniform(y, n, step, ws);
+    } else if (uniformGridStep(x, n, step)) {
+        solveUniform(y, n, step, ws);
+    } else {
+        // Układ równań dla naturalnego splajnu (l[0] = 1, mu[0] = z[0] = 0)
+        for (int i = 1; i < n - 1; i++) {
+            __float128 h0 = x[i] - x[i - 1], h1 = x[i + 1] - x[i];
+            __float128 alpha = 6.0Q * ((y[i + 1] - y[i]) / h1 - (y[i] - y[i - 1]) / h0);
+            __float128 l = 2.0Q * (x[i + 1] - x[i - 1]) - h0 * mu[i - 1];
+            mu[i] = h1 / l;
+            z[i] = (alpha - h0 * z[i - 1]) / l;
+        }
+        z[n - 1] = 0.0Q;
+        c[n - 1] = 0.0Q;
+        for (int j = n - 2; j >= 0; j--) {
+            __float128 h = x[j + 1] - x[j];
+            c[j] = z[j] - mu[j] * c[j + 1];
+            b[j] = (y[j + 1] - y[j]) / h - h * (c[j + 1] + 2.0Q * c[j]) / 6.0Q;
+            d[j] = (c[j + 1] - c[j]) / (6.0Q * h);
+        }
+    }
+    storeSegments(x, y, n, ws, seg);
+}
+
+// Splajn wygładzający (Reinsch). Zamiast interpolacji minimalizujemy
+//   sum w[i]*(y[i] - g[i])^2 + lambda * ∫ S''(x)^2 dx,
+// gdzie g[i] = S(x[i]). Minimum jest naturalnym splajnem przez (x[i], g[i]); dla
+// wewnętrznych gamma[i] = S''(x[i]) spełnia
+//   (R + lambda * Q^T W^-1 Q) * gamma = Q^T y,   g = y - lambda * W^-1 Q gamma,
+// gdzie Q^T y to ilorazy (y[i+1]-y[i])/h[i] - (y[i]-y[i-1])/h[i-1], a R = tridiag(h[i-1]/6,
+// (h[i-1]+h[i])/3, h[i]/6) – ten sam układ co dla splajnu naturalnego, podzielony przez 6.
+// Macierz jest symetryczna, dodatnio określona i pięciodiagonalna, więc rozkład LDL^T
+// i rozwiązanie kosztują O(n).
+struct SplineSmoothing {
+    __float128 lambda = -1.0Q;          // < 0 – wybór przez uogólnioną walidację krzyżową (GCV)
+    vector<__float128> weights;         // wagi w[i] > 0 (puste – wszystkie równe 1)
+};
+
+// Pasma układu Reinscha (indeksy k = i - 1 dla węzłów wewnętrznych i = 1..n-2): r0, r1 – R,
+// m0, m1, m2 – Q^T W^-1 Q (przekątna i dwie naddiagonale), qty – Q^T y. Rozkład
+// R + lambda*M = L*D*L^T z L[k+1][k] = l1[k], L[k+2][k] = l2[k].
+struct ReinschSystem {
+    vector<__float128> h, winv, qty, r0, r1, m0, m1, m2;
+    vector<__float128> dk, l1, l2;
+};
+
+static void buildReinsch(const __float128 *x, const __float128 *y, const __float128 *w, int n,
+                         ReinschSystem &s) {
+    int m = max(n - 2, 0);
+    s.h.resize(n - 1);
+    s.winv.resize(n);
+    for (int i = 0; i < n - 1; i++) {
+        s.h[i] = x[i + 1] - x[i];
+        if (!(s.h[i] > 0))
+            throw std::invalid_argument("Węzły splajnu wygładzającego muszą być ściśle rosnące");
+    }
+    for (int i = 0; i < n; i++) {
+        if (w && !(w[i] > 0))
+            throw std::invalid_argument("Wagi splajnu wygładzającego muszą być dodatnie");
+        s.winv[i] = w ? 1.0Q / w[i] : 1.0Q;
+    }
+    s.qty.assign(m, 0.0Q);
+    s.r0.assign(m, 0.0Q); s.r1.assign(m, 0.0Q);
+    s.m0.assign(m, 0.0Q); s.m1.assign(m, 0.0Q); s.m2.assign(m, 0.0Q);
+    const vector<__float128> &h = s.h, &wi = s.winv;
+    for (int k = 0; k < m; k++) {
+        int i = k + 1;
+        // Kolumna i macierzy Q: 1/h[i-1], -(1/h[i-1] + 1/h[i]), 1/h[i] w wierszach i-1, i, i+1
+        __float128 p = 1.0Q / h[i - 1], q = 1.0Q / h[i], pq = p + q;
+        s.qty[k] = (y[i + 1] - y[i]) * q - (y[i] - y[i - 1]) * p;
+        s.r0[k] = (h[i - 1] + h[i]) / 3.0Q;
+        s.m0[k] = wi[i - 1] * p * p + wi[i] * pq * pq + wi[i + 1] * q * q;
+        if (k + 1 < m) {
+            s.r1[k] = h[i] / 6.0Q;
+            __float128 q2 = 1.0Q / h[i + 1];
+            s.m1[k] = -(wi[i] * pq * q + wi[i + 1] * q * (q + q2));
+            if (k + 2 < m)
+                s.m2[k] = wi[i + 1] * q * q2;
+        }
+    }
+}
+
+static void factorReinsch(ReinschSystem &s, __float128 lambda) {
+    size_t m = s.r0.size();
+    s.dk.resize(m);
+    s.l1.resize(m);
+    s.l2.resize(m);
+    for (size_t k = 0; k < m; k++) {
+        __float128 dk = s.r0[k] + lambda * s.m0[k];
+        if (k >= 1) dk -= s.l1[k - 1] * s.l1[k - 1] * s.dk[k - 1];
+        if (k >= 2) dk -= s.l2[k - 2] * s.l2[k - 2] * s.dk[k - 2];
+        s.dk[k] = dk;
+        __float128 b1 = s.r1[k] + lambda * s.m1[k];
+        if (k >= 1) b1 -= s.l2[k - 1] * s.dk[k - 1] * s.l1[k - 1];
+        s.l1[k] = b1 / dk;
+        s.l2[k] = (lambda * s.m2[k]) / dk;
+    }
+}
+
+// gamma[0..n-1] (gamma[0] = gamma[n-1] = 0) i g[0..n-1] dla rozkładu z factorReinsch
+static void solveReinsch(const ReinschSystem &s, const __float128 *y, int n, __float128 lambda,
+                         __float128 *gamma, __float128 *g) {
+    int m = s.r0.size();
+    gamma[0] = gamma[n - 1] = 0.0Q;
+    __float128 *u = gamma + 1;
+    for (int k = 0; k < m; k++) {
+        __float128 v = s.qty[k];
+        if (k >= 1) v -= s.l1[k - 1] * u[k - 1];
+        if (k >= 2) v -= s.l2[k - 2] * u[k - 2];
+        u[k] = v;
+    }
+    for (int k = m - 1; k >= 0; k--) {
+        __float128 v = u[k] / s.dk[k];
+        if (k + 1 < m) v -= s.l1[k] * u[k + 1];
+        if (k + 2 < m) v -= s.l2[k] * u[k + 2];
+        u[k] = v;
+    }
+    // g = y - lambda * W^-1 * Q * gamma; (Q*gamma)[i] = (gamma[i+1]-gamma[i])/h[i] - (gamma[i]-gamma[i-1])/h[i-1]
+    for (int i = 0; i < n; i++) {
+        __float128 qg = 0.0Q;
+        if (i + 1 < n) qg += (gamma[i + 1] - gamma[i]) / s.h[i];
+        if (i > 0) qg -= (gamma[i] - gamma[i - 1]) / s.h[i - 1];
+        g[i] = y[i] - lambda * s.winv[i] * qg;
+    }
+}
+
+// tr(I - A(lambda)) = lambda * tr(B^-1 * M), B = R + lambda*M. Potrzebne są tylko pasma
+// B^-1 o szerokości pasma M; daje je rekurencja Hutchinsona–de Hooga wstecz po rozkładzie
+// LDL^T, więc całość jest O(n).
+static __float128 reinschResidualTrace(const ReinschSystem &s, __float128 lambda) {
+    int m = s.r0.size();
+    // s0 = B^-1[k][k], s1 = B^-1[k][k+1], s2 = B^-1[k][k+2]; n0, n1 – s0, s1 dla k+1, nn0 – s0 dla k+2
+    __float128 n0 = 0.0Q, n1 = 0.0Q, nn0 = 0.0Q, trace = 0.0Q;
+    for (int k = m - 1; k >= 0; k--) {
+        __float128 s2 = k + 2 < m ? -s.l1[k] * n1 - s.l2[k] * nn0 : 0.0Q;
+        __float128 s1 = k + 1 < m ? -s.l1[k] * n0 - (k + 2 < m ? s.l2[k] * n1 : 0.0Q) : 0.0Q;
+        __float128 s0 = 1.0Q / s.dk[k] - s.l1[k] * s1 - s.l2[k] * s2;
+        trace += s0 * s.m0[k] + 2.0Q * (s1 * s.m1[k] + s2 * s.m2[k]);
+        nn0 = n0;
+        n0 = s0;
+        n1 = s1;
+    }
+    return lambda * trace;
+}
+
+// GCV(lambda) = n * sum w[i]*(y[i]-g[i])^2 / tr(I - A)^2
+static __float128 reinschGcv(ReinschSystem &s, const __float128 *y, int n, __float128 lambda,
+                             __float128 *gamma, __float128 *g) {
+    factorReinsch(s, lambda);
+    solveReinsch(s, y, n, lambda, gamma, g);
+    __float128 rss = 0.0Q;
+    for (int i = 0; i < n; i++)
+        rss += (y[i] - g[i]) * (y[i] - g[i]) / s.winv[i];
+    __float128 t = reinschResidualTrace(s, lambda);
+    if (!(t > 0)) return FLT128_MAX;
+    return (__float128) n * rss / (t * t);
+}
+
+// Dopasowanie splajnu wygładzającego: g[0..n-1] – wartości S w węzłach, segmenty jak
+// z fitCubicSpline (współczynnik a to g[i]). Zwraca użyte lambda.
+static __float128 fitSmoothingSpline(const __float128 *x, const __float128 *y, int n,
+                                     const SplineSmoothing &sm, SplineWorkspace &ws,
+                                     __float128 *g, SplineSegment *seg) {
+    if (!sm.weights.empty() && (int) sm.weights.size() != n)
+        throw std::invalid_argument("Liczba wag musi być równa liczbie węzłów");
+    ReinschSystem s;
+    buildReinsch(x, y, sm.weights.empty() ? nullptr : sm.weights.data(), n, s);
+    ws.c.assign(n, 0.0Q);
+    ws.b.assign(n - 1, 0.0Q);
+    ws.d.assign(n - 1, 0.0Q);
+    __float128 *gamma = ws.c.data();
+    __float128 lambda = sm.lambda;
+    if (lambda < 0 && n >= 4) {
+        // Skala, przy której oba składniki R i lambda*M są porównywalne; GCV minimalizujemy
+        // po t = log10(lambda/scale) – najpierw siatka co 1/2, potem złoty podział
+        __float128 tr = 0.0Q, tm = 0.0Q;
+        for (size_t k = 0; k < s.r0.size(); k++) {
+            tr += s.r0[k];
+            tm += s.m0[k];
+        }
+        __float128 scale = tr / tm;
+        auto score = [&](__float128 t) {
+            return reinschGcv(s, y, n, scale * powq(10.0Q, t), gamma, g);
+        };
+        const __float128 range = 8.0Q, step = 0.5Q;
+        __float128 best = -range, bestScore = score(-range);
+        for (__float128 t = -range + step; t <= range; t += step) {
+            __float128 v = score(t);
+            if (v < bestScore) {
+                bestScore = v;
+                best = t;
+            }
+        }
+        const __float128 ratio = (sqrtq(5.0Q) - 1.0Q) / 2.0Q;
+        __float128 lo = best - step, hi = best + step;
+        __float128 t1 = hi - ratio * (hi - lo), t2 = lo + ratio * (hi - lo);
+        __float128 f1 = score(t1), f2 = score(t2);
+        while (hi - lo > 1e-3Q) {
+            if (f1 < f2) {
+                hi = t2; t2 = t1; f2 = f1;
+                t1 = hi - ratio * (hi - lo);
+                f1 = score(t1);
+            } else {
+                lo = t1; t1 = t2; f1 = f2;
+                t2 = lo + ratio * (hi - lo);
+                f2 = score(t2);
+            }
+        }
+        lambda = scale * powq(10.0Q, (lo + hi) / 2.0Q);
+    } else if (lambda < 0) {
+        // Dla n <= 3 GCV nie ma sensu (n = 3: jedna wartość własna) – interpolacja
+        lambda = 0.0Q;
+    }
+    factorReinsch(s, lambda);
+    solveReinsch(s, y, n, lambda, gamma, g);
+    for (int j = 0; j < n - 1; j++) {
+        __float128 h = s.h[j];
+        ws.b[j] = (g[j + 1] - g[j]) / h - h * (gamma[j + 1] + 2.0Q * gamma[j]) / 6.0Q;
+        ws.d[j] = (gamma[j + 1] - gamma[j]) / (6.0Q * h);
+    }
+    storeSegments(x, g, n, ws, seg);
+    return lambda;
+}
+
+// Pierwiastki S(x) = level. Segment jest dzielony punktami krytycznymi S' = 0 na części
+// monotoniczne; tylko części ze zmianą znaku S - level są przeszukiwane metodą Newtona
+// zabezpieczoną bisekcją, a cały segment jest pomijany, gdy level leży poza [min, max]
+// jego wartości.
+
+// Wartość segmentu dla t = x - s.x (jak NaturalCubicSpline::valueAt)
+static inline __float128 segmentLocalValue(const SplineSegment &s, __float128 t) {
+    return s.a + s.b * t + (s.c / 2.0Q) * t * t + s.d * t * t * t;
+}
+
+// Punkty krytyczne segmentu w (lo, hi), rosnąco: b + c*t + 3d*t^2 = 0
+static int segmentCriticalPoints(const SplineSegment &s, __float128 lo, __float128 hi,
+                                 __float128 t[2]) {
+    __float128 r[2];
+    int count = 0;
+    if (s.d != 0) {
+        __float128 disc = s.c * s.c - 12.0Q * s.d * s.b;
+        if (disc >= 0) {
+            // Postać bez odejmowania bliskich liczb: q = -(c + sign(c)*sqrt(disc))/2
+            __float128 q = -(s.c + copysignq(sqrtq(disc), s.c)) / 2.0Q;
+            r[count++] = q / (3.0Q * s.d);
+            if (q != 0) r[count++] = s.b / q;
+        }
+    } else if (s.c != 0) {
+        r[count++] = -s.b / s.c;
+    }
+    int kept = 0;
+    for (int i = 0; i < count; i++)
+        if (r[i] > lo && r[i] < hi) t[kept++] = r[i];
+    if (kept == 2 && t[0] > t[1]) swap(t[0], t[1]);
+    return kept;
+}
+
+// Pierwiastek w [lo, hi], gdzie segment jest monotoniczny, a f(lo) = fLo i f(hi) mają
+// przeciwne znaki
+static __float128 monotoneRoot(const SplineSegment &s, __float128 level, __float128 lo,
+                               __float128 hi, __float128 fLo) {
+    __float128 t = lo / 2.0Q + hi / 2.0Q;
+    for (int it = 0; it < 200; it++) {
+        __float128 f = segmentLocalValue(s, t) - level;
+        if (f == 0) return t;
+        if ((f < 0) == (fLo < 0)) lo = t; else hi = t;
+        __float128 slope = s.b + s.c * t + 3.0Q * s.d * t * t;
+        __float128 next = t - f / slope;
+        if (!(next > lo && next < hi)) next = lo / 2.0Q + hi / 2.0Q;
+        if (next == t || hi - lo <= FLT128_EPSILON * (fabsq(s.x) + fabsq(hi)))
+            return next;
+        t = next;
+    }
+    return t;
+}
+
+// Pierwiastki segmentu o długości h dopisywane do out (jako x); t = h tylko dla
+// ostatniego segmentu (closedEnd), żeby węzły nie były liczone dwukrotnie
+static void segmentRoots(const SplineSegment &s, __float128 h, __float128 level, bool closedEnd,
+                         vector<__float128> &out) {
+    __float128 pts[4], crit[2];
+    int nc = segmentCriticalPoints(s, 0.0Q, h, crit), np = 0;
+    pts[np++] = 0.0Q;
+    for (int i = 0; i < nc; i++) pts[np++] = crit[i];
+    pts[np++] = h;
+    __float128 fLo = segmentLocalValue(s, 0.0Q) - level;
+    for (int k = 0; k + 1 < np; k++) {
+        __float128 fHi = segmentLocalValue(s, pts[k + 1]) - level;
+        __float128 t = 0.0Q;
+        bool found = true;
+        if (fLo == 0) {
+            t = pts[k];
+        } else if (fHi == 0) {
+            t = pts[k + 1];
+            found = k + 2 == np && closedEnd;
+        } else if ((fLo < 0) != (fHi < 0)) {
+            t = monotoneRoot(s, level, pts[k], pts[k + 1], fLo);
+        } else {
+            found = false;
+        }
+        // Ten sam pierwiastek na granicy części albo segmentów może wyjść dwa razy
+        __float128 x = s.x + t;
+        if (found && (out.empty() || x > out.back()))
+            out.push_back(x);
+        fLo = fHi;
+    }
+}
+
+// ====================
+// Zakresy wartości
+// ====================
+// Najmniejsza i największa wartość splajnu na przedziale. W wersji przedziałowej min i max
+// są obwiedniami: prawdziwe minimum (maksimum) leży w min (max) dla każdego wyboru danych.
+template<typename T>
+struct SplineRange {
+    T min, max;
+};
+
+static inline SplineRange<__float128> joinRange(const SplineRange<__float128> &a,
+                                                const SplineRange<__float128> &b) {
+    return {fminq(a.min, b.min), fmaxq(a.max, b.max)};
+}
+
+static inline SplineRange<Interval> joinRange(const SplineRange<Interval> &a,
+                                              const SplineRange<Interval> &b) {
+    return {{fminq(a.min.lo, b.min.lo), fminq(a.min.hi, b.min.hi)},
+            {fmaxq(a.max.lo, b.max.lo), fmaxq(a.max.hi, b.max.hi)}};
+}
+
+// Złączenie (joinRange) zakresów pozycji l..r w czasie O(1). Pozycje są grupowane w bloki
+// po BLOCK; prefix[i] to złączenie od początku bloku do i, suffix[i] – od i do końca bloku,
+// a sparse[k][j] – bloków j..j+2^k-1. Pamięć O(n) zamiast O(n log n) tablicy rzadkiej nad
+// wszystkimi pozycjami; zapytanie w obrębie jednego bloku przegląda co najwyżej BLOCK pozycji.
+template<typename T>
+class RangeTable {
+private:
+    static const size_t BLOCK = 16;
+    vector<SplineRange<T>> items, prefix, suffix;
+    vector<vector<SplineRange<T>>> sparse;
+
+public:
+    RangeTable() {
+    }
+
+    explicit RangeTable(vector<SplineRange<T>> values) : items(std::move(values)) {
+        size_t n = items.size();
+        if (n == 0)
+            return;
+        prefix = items;
+        suffix = items;
+        for (size_t i = 1; i < n; i++)
+            if (i % BLOCK != 0) prefix[i] = joinRange(prefix[i - 1], items[i]);
+        for (size_t i = n - 1; i-- > 0;)
+            if ((i + 1) % BLOCK != 0) suffix[i] = joinRange(items[i], suffix[i + 1]);
+        size_t blocks = (n + BLOCK - 1) / BLOCK;
+        sparse.emplace_back(blocks);
+        for (size_t j = 0; j < blocks; j++)
+            sparse[0][j] = suffix[j * BLOCK];
+        for (size_t k = 1; (size_t(1) << k) <= blocks; k++) {
+            size_t half = size_t(1) << (k - 1);
+            sparse.emplace_back(blocks - 2 * half + 1);
+            for (size_t j = 0; j + 2 * half <= blocks; j++)
+                sparse[k][j] = joinRange(sparse[k - 1][j], sparse[k - 1][j + half]);
+        }
+    }
+
+    size_t size() const {
+        return items.size();
+    }
+
+    // Złączenie pozycji l..r (l <= r < size())
+    SplineRange<T> query(size_t l, size_t r) const {
+        size_t bl = l / BLOCK, br = r / BLOCK;
+        if (bl == br) {
+            SplineRange<T> out = items[l];
+            for (size_t i = l + 1; i <= r; i++)
+                out = joinRange(out, items[i]);
+            return out;
+        }
+        SplineRange<T> out = joinRange(suffix[l], prefix[r]);
+        if (bl + 1 < br) {
+            size_t first = bl + 1, count = br - first;
+            int k = 63 - __builtin_clzll(count);
+            out = joinRange(out, joinRange(sparse[k][first], sparse[k][br - (size_t(1) << k)]));
+        }
+        return out;
+    }
+};
+
+// Zakres wartości segmentu dla t z [t0, t1]: końce i punkty krytyczne między nimi
+static SplineRange<__float128> segmentRange(const SplineSegment &s, __float128 t0,
+                                            __float128 t1) {
+    __float128 crit[2];
+    __float128 v0 = segmentLocalValue(s, t0), v1 = segmentLocalValue(s, t1);
+    SplineRange<__float128> r = {fminq(v0, v1), fmaxq(v0, v1)};
+    int nc = segmentCriticalPoints(s, t0, t1, crit);
+    for (int k = 0; k < nc; k++) {
+        __float128 v = segmentLocalValue(s, crit[k]);
+        r.min = fminq(r.min, v);
+        r.max = fmaxq(r.max, v);
+    }
+    return r;
+}
+
+// ====================
+// Podział pracy między wątki
+// ====================
+// Liczba wątków: threads albo – dla 0 – tyle, ile rdzeni
+static unsigned workerCount(unsigned threads) {
+    return threads != 0 ? threads : max(1u, std::thread::hardware_concurrency());
+}
+
+// Części t = 0..chunks-1 zakresu 0..count-1, body(t, first, last); część 0 liczy wątek
+// wywołujący. Wyjątek z części nie może opuścić funkcji wątku (std::terminate), więc jest
+// przechwytywany, a po zakończeniu wszystkich wątków zgłaszany jest ponownie pierwszy
+// według numeru części. Gdy system nie pozwala uruchomić kolejnego wątku, pozostałe części
+// liczy wątek wywołujący.
+template <class Body>
+static void parallelChunks(size_t count, size_t chunks, Body body) {
+    if (chunks <= 1) {
+        body(0, 0, count);
+        return;
+    }
+    vector<std::exception_ptr> errors(chunks);
+    auto run = [&](size_t t) {
+        try {
+            body(t, count * t / chunks, count * (t + 1) / chunks);
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+    vector<std::thread> workers;
+    workers.reserve(chunks - 1);
+    size_t started = 1;
+    try {
+        for (; started < chunks; started++)
+            workers.emplace_back(run, started);
+    } catch (const std::system_error &) {
+    }
+    for (size_t t = started; t < chunks; t++)
+        run(t);
+    run(0);
+    for (auto &w : workers)
+        w.join();
+    for (auto &e : errors)
+        if (e)
+            std::rethrow_exception(e);
+}
+
+// Zakres 0..count-1 dzielony na ciągłe części dla threads wątków (0 – tyle, ile rdzeni),
+// ale nie mniejsze niż grain elementów
+template <class Body>
+static void parallelRanges(size_t count, unsigned threads, size_t grain, Body body) {
+    size_t chunks = min<size_t>({(size_t) workerCount(threads), max<size_t>(1, count / grain)});
+    parallelChunks(count, chunks, [&](size_t, size_t first, size_t last) {
+        body(first, last);
+    });
+}
+
 class NaturalCubicSpline {
 private:
     vector<__float128> x, y, h;
     vector<SplineSegment> segments;
+    KnotIndex index;
+    __float128 lambda = 0.0Q;          // parametr wygładzania (0 – interpolacja)
+
 public:
-    NaturalCubicSpline(const vector<__float128>& x_in, const vector<__float128>& y_in) {
+    // uniformGrid – wywołujący deklaruje równe odstępy węzłów (bez tego są wykrywane)
+    NaturalCubicSpline(const vector<__float128>& x_in, const vector<__float128>& y_in,
+                       bool uniformGrid = false)
+        : NaturalCubicSpline(x_in, y_in, SplineBoundary<__float128>(), uniformGrid) {
+    }
+
+    // Splajn z warunkami brzegowymi bc (domyślnie naturalnymi)
+    NaturalCubicSpline(const vector<__float128>& x_in, const vector<__float128>& y_in,
+                       const SplineBoundary<__float128> &bc, bool uniformGrid = false) {
         x = x_in; y = y_in;
+        index.build(x);
         int n = x.size();
         h.resize(n - 1);
         for (int i = 0; i < n - 1; i++) {
             h[i] = x[i + 1] - x[i];
         }
-        // Układ równań dla naturalnego splajnu
-        vector<__float128> alpha(n, 0.0Q), l(n, 0.0Q), mu(n, 0.0Q), z(n, 0.0Q);
-        l[0] = 1.0Q; mu[0] = 0.0Q; z[0] = 0.0Q;
-        for (int i = 1; i < n - 1; i++) {
-            alpha[i] = 6.0Q * ((y[i + 1] - y[i]) / h[i] - (y[i] - y[i - 1]) / h[i - 1]);
-            l[i] = 2.0Q * (x[i + 1] - x[i - 1]) - h[i - 1] * mu[i - 1];
-            mu[i] = h[i] / l[i];
-            z[i] = (alpha[i] - h[i - 1] * z[i - 1]) / l[i];
+        segments.resize(n - 1);
+        if (n >= 2) {
+            SplineWorkspace ws;
+            fitCubicSpline(x.data(), y.data(), n, bc, uniformGrid, ws, segments.data());
         }
-        l[n - 1] = 1.0Q; z[n - 1] = 0.0Q;
-        vector<__float128> c(n, 0.0Q), b(n - 1, 0.0Q), d(n - 1, 0.0Q);
-        c[n - 1] = 0.0Q;
-        for (int j = n - 2; j >= 0; j--) {
-            c[j] = z[j] - mu[j] * c[j + 1];
-            b[j] = (y[j + 1] - y[j]) / h[j] - h[j] * (c[j + 1] + 2.0Q * c[j]) / 6.0Q;
-            d[j] = (c[j + 1] - c[j]) / (6.0Q * h[j]);
+    }
+
+    // Splajn wygładzający (warunki naturalne): S nie przechodzi przez y_in, y przechowuje
+    // wartości S(x[i]). Dla smoothing.lambda < 0 parametr wybiera GCV.
+    NaturalCubicSpline(const vector<__float128>& x_in, const vector<__float128>& y_in,
+                       const SplineSmoothing &smoothing) {
+        x = x_in; y = y_in;
+        index.build(x);
+        int n = x.size();
+        h.resize(n - 1);
+        for (int i = 0; i < n - 1; i++) {
+            h[i] = x[i + 1] - x[i];
         }
-        // Wypełniamy segmenty
         segments.resize(n - 1);
-        for (int i = 0; i < n - 1; i++) {
-            segments[i].a = y[i];
-            segments[i].b = b[i];
-            segments[i].c = c[i]; // zachowujemy oryginalne c[i]
-            segments[i].d = d[i];
-            segments[i].x = x[i];
-            __float128 xi = x[i];
-            segments[i].a0 = segments[i].a - segments[i].b * xi + (segments[i].c * xi * xi) / 2.0Q - segments[i].d * xi * xi * xi;
-            segments[i].a1 = segments[i].b - segments[i].c * xi + 3.0Q * segments[i].d * xi * xi;
-            segments[i].a2 = (segments[i].c) / 2.0Q - 3.0Q * segments[i].d * xi;
-            segments[i].a3 = segments[i].d;
+        if (n >= 2) {
+            SplineWorkspace ws;
+            lambda = fitSmoothingSpline(x.data(), y_in.data(), n, smoothing, ws, y.data(),
+                                        segments.data());
         }
     }
+
+    // Użyty parametr wygładzania (0 dla splajnu interpolującego)
+    __float128 smoothingParameter() const {
+        return lambda;
+    }
     
     // Obliczenie S(xi) przy użyciu postaci lokalnej
     tuple<__float128, __float128, __float128, __float128, __float128> evaluate(__float128 xi) {
         int n = segments.size();
         if (n == 0) return {0.0Q,0.0Q,0.0Q,0.0Q,0.0Q};
+        int seg = index.segment(xi);
+        __float128 value = valueAt(seg, xi);
+        return {value, segments[seg].a, segments[seg].b, (segments[seg].c/2.0Q), segments[seg].d};
+    }
+
+    // Wartość segmentu seg w punkcie xi (postać lokalna)
+    __float128 valueAt(int seg, __float128 xi) const {
+        __float128 dx = xi - segments[seg].x;
+        return segments[seg].a + segments[seg].b * dx +
+               (segments[seg].c / 2.0Q) * dx * dx +
+               segments[seg].d * dx * dx * dx;
+    }
+
+    // Podział siatki x0 + k*dx na podzakresy jednego segmentu: body(seg, k, end) dostaje
+    // punkty k..end-1 leżące w segmencie seg (według reguły evaluate).
+    template <class Body>
+    void resampleRange(__float128 x0, __float128 dx, size_t k, size_t end, Body &body) const {
+        if (k >= end || segments.empty())
+            return;
+        int last = (int) segments.size() - 1;
+        int seg = index.segment(x0 + (__float128) k * dx);
+        double invStep = 1.0 / (double) dx;
+        while (k < end) {
+            size_t stop = end;
+            if (seg < last) {
+                // Pierwszy punkt >= x[seg+1]: oszacowanie w double i korekta dokładnym porównaniem
+                __float128 bound = x[seg + 1];
+                double est = ceil((double) (bound - x0) * invStep);
+                stop = est <= (double) k ? k : est >= (double) end ? end : (size_t) est;
+                while (stop > k && x0 + (__float128) (stop - 1) * dx >= bound)
+                    stop--;
+                while (stop < end && x0 + (__float128) stop * dx < bound)
+                    stop++;
+            }
+            if (stop > k)
+                body(seg, k, stop);
+            k = stop;
+            seg++;
+        }
+    }
+
+    template <class Body>
+    void resampleParallel(__float128 x0, __float128 dx, size_t count, unsigned threads,
+                          Body body) const {
+        // Przejście w przód wymaga rosnącej siatki; inaczej każdy punkt osobno przez indeks
+        if (!(dx > 0)) {
+            for (size_t k = 0; k < count; k++)
+                body(index.segment(x0 + (__float128) k * dx), k, k + 1);
+            return;
+        }
+        // Mniej niż 64 tys. punktów na wątek nie pokrywa kosztu jego uruchomienia
+        parallelRanges(count, threads, 65536, [&](size_t first, size_t last) {
+            resampleRange(x0, dx, first, last, body);
+        });
+    }
+
+    // Kursor dla rosnących zapytań: pamięta ostatni segment i przesuwa się do przodu, więc
+    // ciąg zapytań niemalejących kosztuje zamortyzowane O(1) na zapytanie. Cofnięcie albo
+    // skok o wiele segmentów przechodzi na indeks. Segment jest ten sam co w evaluate.
+    class Cursor {
+    private:
+        const NaturalCubicSpline *spline;
         int seg = 0;
-        if (xi < x[0])
-            seg = 0;
-        else if (xi >= x[x.size()-1])
-            seg = x.size()-2;
-        else {
-            for (int i = 0; i < x.size()-1; i++) {
-                if (xi >= x[i] && xi < x[i+1]) { seg = i; break; }
+    public:
+        explicit Cursor(const NaturalCubicSpline &s) : spline(&s) {
+        }
+
+        int segment(__float128 xi) {
+            const vector<__float128> &x = spline->x;
+            int last = (int) spline->segments.size() - 1;
+            if (!(xi >= x[seg]))
+                return seg = spline->index.segment(xi);
+            for (int step = 0; seg < last && xi >= x[seg + 1]; step++) {
+                if (step == 8)
+                    return seg = spline->index.segment(xi);
+                seg++;
             }
+            return seg;
         }
-        __float128 dx = xi - segments[seg].x;
-        __float128 value = segments[seg].a + segments[seg].b * dx +
-                           (segments[seg].c / 2.0Q) * dx * dx +
-                           segments[seg].d * dx * dx * dx;
-        return {value, segments[seg].a, segments[seg].b, (segments[seg].c/2.0Q), segments[seg].d};
+
+        __float128 value(__float128 xi) {
+            if (spline->segments.empty()) return 0.0Q;
+            return spline->valueAt(segment(xi), xi);
+        }
+    };
+
+    Cursor cursor() const {
+        return Cursor(*this);
+    }
+
+    // Wartości S(x0 + k*dx) dla k = 0..count-1 zapisane kolejno do out. Punkty siatki
+    // i segmenty przechodzone są razem: dla każdego segmentu wyznaczamy od razu cały jego
+    // podzakres siatki, a zakres [0, count) dzielimy między wątki (threads = 0 – tyle, ile
+    // rdzeni). Wynik jest taki sam jak z evaluate w każdym punkcie.
+    void resample(__float128 x0, __float128 dx, size_t count, __float128 *out,
+                  unsigned threads = 0) const {
+        if (segments.empty()) {
+            fill(out, out + count, 0.0Q);
+            return;
+        }
+        resampleParallel(x0, dx, count, threads, [&](int seg, size_t k, size_t end) {
+            for (; k < end; k++)
+                out[k] = valueAt(seg, x0 + (__float128) k * dx);
+        });
+    }
+
+    // To samo z wynikiem w double: współczynniki segmentu i przesunięcie pierwszego punktu
+    // względem węzła są zaokrąglane do double, a wielomian liczony schematem Hornera po
+    // czterech punktach naraz (wektory GCC – SSE2/AVX zależnie od opcji kompilacji).
+    // Błąd względem wyniku float128 jest rzędu kilku eps double razy |a| + |b*t| + |c*t^2| + ...
+    void resample(__float128 x0, __float128 dx, size_t count, double *out,
+                  unsigned threads = 0) const {
+        typedef double v4d __attribute__((vector_size(32)));
+        if (segments.empty()) {
+            fill(out, out + count, 0.0);
+            return;
+        }
+        double step = (double) dx;
+        resampleParallel(x0, dx, count, threads, [&](int seg, size_t k, size_t end) {
+            const SplineSegment &s = segments[seg];
+            double a = (double) s.a, b = (double) s.b, c = (double) (s.c / 2.0Q), d = (double) s.d;
+            // t_j = t_r + (j - r)*dx, gdzie r to punkt podzakresu najbliższy węzłowi x_i
+            // (t_r liczone w float128), więc błąd t_j jest rzędu eps*(|t_j| + dx) – także
+            // dla punktów przed x[0], gdzie liczenie od pierwszego punktu traciłoby cyfry
+            size_t len = end - k, j = 0;
+            double first = (double) (x0 + (__float128) k * dx - s.x);
+            double r = fmin(fmax(nearbyint(-first / step), 0.0), (double) (len - 1));
+            double tr = r == 0 ? first : (double) (x0 + (__float128) (k + (size_t) r) * dx - s.x);
+            v4d lane = {0.0, 1.0, 2.0, 3.0};
+            for (; j + 4 <= len; j += 4) {
+                v4d t = tr + (lane + ((double) j - r)) * step;
+                v4d v = a + t * (b + t * (c + t * d));
+                memcpy(out + k + j, &v, sizeof(v));
+            }
+            for (; j < len; j++) {
+                double t = tr + ((double) j - r) * step;
+                out[k + j] = a + t * (b + t * (c + t * d));
+            }
+        });
     }
     
+    // Wszystkie x z [x[0], x[n-1]], w których S(x) = level, rosnąco (bez ekstrapolacji;
+    // pierwiastki styczne wykrywane tylko, gdy wartość w punkcie krytycznym jest dokładna)
+    vector<__float128> roots(__float128 level) const {
+        return roots(vector<__float128>{level})[0];
+    }
+
+    // Pierwiastki dla wielu poziomów naraz: zakresy wartości segmentów liczone raz, a dla
+    // każdego segmentu przeglądane są tylko poziomy z jego zakresu (posortowane)
+    vector<vector<__float128>> roots(const vector<__float128> &levels) const {
+        vector<vector<__float128>> out(levels.size());
+        vector<size_t> order(levels.size());
+        for (size_t k = 0; k < order.size(); k++) order[k] = k;
+        sort(order.begin(), order.end(), [&](size_t a, size_t b) { return levels[a] < levels[b]; });
+        vector<__float128> sorted(order.size());
+        for (size_t k = 0; k < order.size(); k++) sorted[k] = levels[order[k]];
+        int count = segments.size();
+        for (int i = 0; i < count; i++) {
+            SplineRange<__float128> r = segmentRange(segments[i], 0.0Q, h[i]);
+            for (size_t k = lower_bound(sorted.begin(), sorted.end(), r.min) - sorted.begin();
+                 k < sorted.size() && sorted[k] <= r.max; k++)
+                segmentRoots(segments[i], h[i], sorted[k], i == count - 1, out[order[k]]);
+        }
+        return out;
+    }
+
+    // Zapytania o najmniejszą i największą wartość S na [a, b]. Zakresy segmentów liczone są
+    // raz przy tworzeniu (O(n)); zapytanie bierze pełne segmenty między a i b z RangeTable,
+    // a dokładnie (końce i punkty krytyczne) liczy tylko dwa segmenty brzegowe. Poza
+    // [x[0], x[n-1]] S jest ekstrapolowany jak w evaluate. Obiekt trzyma wskaźnik na splajn.
+    class Extrema {
+    private:
+        const NaturalCubicSpline *spline;
+        RangeTable<__float128> table;
+    public:
+        explicit Extrema(const NaturalCubicSpline &s) : spline(&s) {
+            vector<SplineRange<__float128>> r(s.segments.size());
+            for (size_t i = 0; i < r.size(); i++)
+                r[i] = segmentRange(s.segments[i], 0.0Q, s.h[i]);
+            table = RangeTable<__float128>(std::move(r));
+        }
+
+        SplineRange<__float128> range(__float128 a, __float128 b) const {
+            const vector<SplineSegment> &seg = spline->segments;
+            if (seg.empty()) return {0.0Q, 0.0Q};
+            if (b < a) swap(a, b);
+            int i = spline->index.segment(a), j = spline->index.segment(b);
+            if (i == j)
+                return segmentRange(seg[i], a - seg[i].x, b - seg[i].x);
+            SplineRange<__float128> out = joinRange(
+                segmentRange(seg[i], a - seg[i].x, spline->h[i]),
+                segmentRange(seg[j], 0.0Q, b - seg[j].x));
+            if (i + 1 < j)
+                out = joinRange(out, table.query(i + 1, j - 1));
+            return out;
+        }
+    };
+
+    Extrema extrema() const {
+        return Extrema(*this);
+    }
+
     // Wypisanie współczynników globalnych (macierz a[0..3, 0..(n-2)])
     void printCoefficients(ofstream& outputFile) {
         const int numCoeff = 4;
@@ -172,212 +1293,2516 @@ public:
     }
 };
 
+// Wiele niezależnych małych splajnów dopasowanych naraz. Zbiór j ma węzły
+// offsets[j]..offsets[j+1]-1 płaskich tablic x, y, a jego n_j - 1 segmentów leży w jednym
+// wspólnym buforze od pozycji offsets[j] - j. Zamiast obiektu NaturalCubicSpline (kilkanaście
+// alokacji i indeks) na każdy zbiór – jeden obszar roboczy i jeden bufor współczynników.
+// Współczynniki są identyczne jak z NaturalCubicSpline dla tych samych danych i warunków
+// brzegowych.
+class SplineBatch {
+private:
+    vector<size_t> offsets;
+    vector<__float128> x;
+    vector<SplineSegment> segments;
+public:
+    // threads = 0 – tyle wątków, ile rdzeni (każdy z własnym obszarem roboczym)
+    SplineBatch(const vector<__float128>& x_in, const vector<__float128>& y_in,
+                const vector<size_t>& offsets_in, bool uniformGrid = false, unsigned threads = 0,
+                const SplineBoundary<__float128> &bc = SplineBoundary<__float128>()) {
+        if (offsets_in.empty() || offsets_in.front() != 0 || offsets_in.back() != x_in.size() ||
+            x_in.size() != y_in.size())
+            throw std::invalid_argument("Niepoprawne przesunięcia zbiorów danych");
+        for (size_t j = 0; j + 1 < offsets_in.size(); j++)
+            if (offsets_in[j + 1] < offsets_in[j] + 2)
+                throw std::invalid_argument("Każdy zbiór danych musi mieć co najmniej dwa węzły");
+        offsets = offsets_in;
+        x = x_in;
+        size_t count = offsets.size() - 1;
+        segments.resize(x.size() - count);
+        // Zbiory są niezależne; wątek dostaje ciągły zakres zbiorów, ale nie mniej niż
+        // ok. 4 tys. węzłów, bo koszt uruchomienia wątku przewyższyłby zysk. Błąd danych
+        // któregoś zbioru (np. y[n-1] != y[0] przy warunku okresowym) wraca jako wyjątek.
+        size_t chunks = min<size_t>({(size_t) workerCount(threads), count,
+                                     max<size_t>(1, x.size() / 4096)});
+        parallelChunks(count, chunks, [&](size_t, size_t first, size_t last) {
+            SplineWorkspace ws;
+            for (size_t j = first; j < last; j++)
+                fitCubicSpline(x.data() + offsets[j], y_in.data() + offsets[j],
+                               (int) (offsets[j + 1] - offsets[j]), bc, uniformGrid, ws,
+                               segments.data() + offsets[j] - j);
+        });
+    }
+
+    // Liczba zbiorów danych
+    size_t size() const {
+        return offsets.size() - 1;
+    }
+
+    size_t segmentCount(size_t j) const {
+        return offsets[j + 1] - offsets[j] - 1;
+    }
+
+    const SplineSegment *segmentsOf(size_t j) const {
+        return segments.data() + offsets[j] - j;
+    }
+
+    // Wspólny bufor współczynników wszystkich zbiorów
+    const vector<SplineSegment> &getSegments() const {
+        return segments;
+    }
+
+    // S_j(xi) – segment jak w NaturalCubicSpline::evaluate (zbiory są małe, więc
+    // wyszukiwanie binarne zamiast indeksu)
+    __float128 evaluate(size_t j, __float128 xi) const {
+        const __float128 *first = x.data() + offsets[j], *last = x.data() + offsets[j + 1];
+        long seg = (long) (upper_bound(first, last, xi) - first) - 1;
+        seg = max(0L, min(seg, (long) segmentCount(j) - 1));
+        const SplineSegment &s = segmentsOf(j)[seg];
+        __float128 dx = xi - s.x;
+        return s.a + s.b * dx + (s.c / 2.0Q) * dx * dx + s.d * dx * dx * dx;
+    }
+};
+
+// Wiele kanałów danych na wspólnych węzłach (np. kilka czujników): wartości y[i*k + ch]
+// kanału ch w węźle x[i]. Układ splajnu naturalnego zależy tylko od x, więc jego
+// faktoryzacja (mu i piwoty l algorytmu Thomasa) jest liczona raz, a każdy przebieg
+// eliminacji obsługuje wszystkie kanały naraz – kanały są wymiarem wewnętrznym, tablice
+// czytane są sekwencyjnie. Współczynniki też leżą kanałami obok siebie, więc jedno
+// wyszukanie segmentu wystarcza do wartości wszystkich kanałów. Dla siatek nierównomiernych
+// wynik jest bit w bit taki jak z osobnych NaturalCubicSpline; stały układ siatki
+// równomiernej nie jest tu używany (różnice na ostatnich bitach).
+class MultiChannelSpline {
+private:
+    size_t k = 0;                          // liczba kanałów
+    vector<__float128> x, h, mu, pivot;
+    KnotIndex index;
+    vector<__float128> a, b, half, d;      // [seg*k + ch]; half = S''(x[seg])/2
+    vector<__float128> c;                  // [i*k + ch] – S''(x[i]), także bufor eliminacji
+
+public:
+    // Sama faktoryzacja – dane przez fit
+    MultiChannelSpline(const vector<__float128>& x_in, size_t channels) {
+        x = x_in;
+        k = channels;
+        int n = x.size();
+        if (n < 2 || k == 0)
+            throw std::invalid_argument("Splajn wielokanałowy wymaga co najmniej dwóch węzłów i jednego kanału");
+        index.build(x);
+        h.resize(n - 1);
+        for (int i = 0; i < n - 1; i++)
+            h[i] = x[i + 1] - x[i];
+        mu.assign(n, 0.0Q);
+        pivot.assign(n, 1.0Q);
+        for (int i = 1; i < n - 1; i++) {
+            __float128 l = 2.0Q * (x[i + 1] - x[i - 1]) - h[i - 1] * mu[i - 1];
+            pivot[i] = l;
+            mu[i] = h[i] / l;
+        }
+    }
+
+    MultiChannelSpline(const vector<__float128>& x_in, const vector<__float128>& y,
+                       size_t channels) : MultiChannelSpline(x_in, channels) {
+        fit(y);
+    }
+
+    // Dopasowanie wszystkich kanałów do nowych danych (faktoryzacja bez zmian)
+    void fit(const vector<__float128>& y) {
+        int n = x.size();
+        if (y.size() != n * k)
+            throw std::invalid_argument("Liczba wartości y musi być równa liczbie węzłów razy liczba kanałów");
+        c.assign(n * k, 0.0Q);
+        a.resize((n - 1) * k);
+        b.resize((n - 1) * k);
+        half.resize((n - 1) * k);
+        d.resize((n - 1) * k);
+        // Eliminacja w przód: c przechowuje z (z[0] = 0)
+        for (int i = 1; i < n - 1; i++) {
+            const __float128 *y0 = &y[(i - 1) * k], *y1 = &y[i * k], *y2 = &y[(i + 1) * k];
+            const __float128 *zPrev = &c[(i - 1) * k];
+            __float128 *z = &c[i * k];
+            __float128 h0 = h[i - 1], h1 = h[i], l = pivot[i];
+            for (size_t ch = 0; ch < k; ch++) {
+                __float128 alpha = 6.0Q * ((y2[ch] - y1[ch]) / h1 - (y1[ch] - y0[ch]) / h0);
+                z[ch] = (alpha - h0 * zPrev[ch]) / l;
+            }
+        }
+        // Podstawienie wstecz (c[n-1] = 0) i współczynniki segmentów
+        for (int j = n - 2; j >= 0; j--) {
+            __float128 *cj = &c[j * k];
+            const __float128 *cNext = &c[(j + 1) * k];
+            const __float128 *yj = &y[j * k], *yNext = &y[(j + 1) * k];
+            __float128 hj = h[j], m = mu[j];
+            for (size_t ch = 0; ch < k; ch++) {
+                cj[ch] = cj[ch] - m * cNext[ch];
+                size_t s = j * k + ch;
+                a[s] = yj[ch];
+                b[s] = (yNext[ch] - yj[ch]) / hj - hj * (cNext[ch] + 2.0Q * cj[ch]) / 6.0Q;
+                half[s] = cj[ch] / 2.0Q;
+                d[s] = (cNext[ch] - cj[ch]) / (6.0Q * hj);
+            }
+        }
+    }
+
+    size_t channelCount() const {
+        return k;
+    }
+
+    // out[ch] = S_ch(xi) dla wszystkich kanałów – jeden wybór segmentu
+    void evaluate(__float128 xi, __float128 *out) const {
+        int seg = index.segment(xi);
+        __float128 dx = xi - x[seg];
+        size_t base = seg * k;
+        for (size_t ch = 0; ch < k; ch++)
+            out[ch] = a[base + ch] + b[base + ch] * dx + half[base + ch] * dx * dx +
+                      d[base + ch] * dx * dx * dx;
+    }
+
+    // Segment seg kanału ch w postaci NaturalCubicSpline (z postacią globalną)
+    SplineSegment segment(size_t ch, int seg) const {
+        SplineSegment s;
+        size_t p = seg * k + ch;
+        s.a = a[p];
+        s.b = b[p];
+        s.c = c[seg * k + ch];
+        s.d = d[p];
+        s.x = x[seg];
+        globalForm(s);
+        return s;
+    }
+};
+
+// Splajn regresyjny: naturalny splajn o zadanych węzłach x[0..n-1] dopasowany metodą
+// najmniejszych kwadratów do dowolnie wielu próbek (xs, ys) z [x[0], x[n-1]]. Baza to
+// sześcienne B-splajny na węzłach z potrojonymi końcami (n + 2 funkcji, w każdym punkcie
+// co najwyżej 4 niezerowe); warunki S''(x[0]) = S''(x[n-1]) = 0 eliminują pierwszy
+// i ostatni współczynnik, zostaje n niewiadomych. Macierz równań normalnych jest pasmowa
+// (półszerokość 3), więc próbki są akumulowane strumieniowo w pamięci O(n) – kolejne
+// porcje przez add, równolegle przez osobne akumulatory łączone w merge – a rozkład LDL^T
+// pasma kosztuje O(n). Wynik to zwykły NaturalCubicSpline przez wartości S(x[i]).
+class SplineRegression {
+private:
+    vector<__float128> x;
+    vector<__float128> tau;           // węzły B-splajnów: tau[3 + i] = x[i], końce potrojone
+    __float128 rho = 0.0Q, sigma = 0.0Q; // c[0] = (1+rho)*c[1] - rho*c[2], symetrycznie na końcu
+    KnotIndex index;
+    vector<array<__float128, 4>> gram; // gram[r][o] = suma w*B_r*B_(r+o)
+    vector<__float128> rhs;
+    size_t samples = 0;
+
+    // Wartości zredukowanej bazy w punkcie t z segmentu seg: val[q] dla niewiadomej seg + q - 1
+    // (indeksy spoza [0, n-1] mają wagę 0)
+    void basis(int seg, __float128 t, __float128 val[4]) const {
+        int k = seg + 3;
+        // Cox–de Boor: N[j] – B-splajn o numerze k - 3 + j
+        __float128 N[4], left[4], right[4];
+        N[0] = 1.0Q;
+        for (int j = 1; j <= 3; j++) {
+            left[j] = t - tau[k + 1 - j];
+            right[j] = tau[k + j] - t;
+            __float128 saved = 0.0Q;
+            for (int r = 0; r < j; r++) {
+                __float128 temp = N[r] / (right[r + 1] + left[j - r]);
+                N[r] = saved + right[r + 1] * temp;
+                saved = left[j - r] * temp;
+            }
+            N[j] = saved;
+        }
+        int n = x.size(), last = n + 1;
+        val[0] = val[1] = val[2] = val[3] = 0.0Q;
+        for (int j = 0; j < 4; j++) {
+            int i = k - 3 + j;            // numer B-splajnu, niewiadoma i - 1 = seg + j - 1
+            if (i == 0) {
+                val[1] += (1.0Q + rho) * N[j];
+                val[2] -= rho * N[j];
+            } else if (i == last) {
+                val[j - 1] += (1.0Q + sigma) * N[j];
+                val[j - 2] -= sigma * N[j];
+            } else {
+                val[j] += N[j];
+            }
+        }
+    }
+
+    // Wszystkie próbki muszą leżeć w [x[0], x[n-1]]; sprawdzane przed akumulacją, więc
+    // porcja z błędną próbką nie zmienia sum
+    void checkSamples(const __float128 *xs, size_t count) const {
+        for (size_t p = 0; p < count; p++)
+            if (!(xs[p] >= x.front() && xs[p] <= x.back()))
+                throw std::invalid_argument("Próbka splajnu regresyjnego leży poza zakresem węzłów");
+    }
+
+    void accumulate(const __float128 *xs, const __float128 *ys, size_t count,
+                    const __float128 *w) {
+        int n = x.size();
+        for (size_t p = 0; p < count; p++) {
+            int seg = index.segment(xs[p]);
+            __float128 val[4];
+            basis(seg, xs[p], val);
+            __float128 wp = w ? w[p] : 1.0Q;
+            for (int a = 0; a < 4; a++) {
+                int r = seg + a - 1;
+                if (r < 0 || r >= n || val[a] == 0) continue;
+                __float128 wv = wp * val[a];
+                rhs[r] += wv * ys[p];
+                for (int b = a; b < 4; b++)
+                    gram[r][b - a] += wv * val[b];
+            }
+        }
+        samples += count;
+    }
+
+public:
+    explicit SplineRegression(const vector<__float128> &knots) {
+        x = knots;
+        int n = x.size();
+        if (n < 2)
+            throw std::invalid_argument("Splajn regresyjny wymaga co najmniej dwóch węzłów");
+        for (int i = 0; i < n - 1; i++)
+            if (!(x[i + 1] > x[i]))
+                throw std::invalid_argument("Węzły splajnu regresyjnego muszą być ściśle rosnące");
+        index.build(x);
+        tau.resize(n + 6);
+        for (int i = 0; i < n + 6; i++)
+            tau[i] = x[min(max(i - 3, 0), n - 1)];
+        // S''(x[0]) = 0: (c2 - c1)/(tau5 - tau2) = (c1 - c0)/(tau4 - tau1)
+        rho = (tau[4] - tau[1]) / (tau[5] - tau[2]);
+        int N = n + 2;
+        sigma = (tau[N + 2] - tau[N - 1]) / (tau[N + 1] - tau[N - 2]);
+        gram.assign(n, {0.0Q, 0.0Q, 0.0Q, 0.0Q});
+        rhs.assign(n, 0.0Q);
+    }
+
+    // Porcja próbek (w – opcjonalne wagi > 0)
+    void add(const __float128 *xs, const __float128 *ys, size_t count,
+             const __float128 *w = nullptr) {
+        checkSamples(xs, count);
+        accumulate(xs, ys, count, w);
+    }
+
+    // Równoległa akumulacja: każdy wątek ma własne sumy O(n), łączone na końcu
+    // (threads = 0 – tyle wątków, ile rdzeni)
+    void add(const vector<__float128> &xs, const vector<__float128> &ys, unsigned threads,
+             const vector<__float128> &weights = {}) {
+        if (xs.size() != ys.size() || (!weights.empty() && weights.size() != xs.size()))
+            throw std::invalid_argument("Liczby próbek x, y i wag muszą być równe");
+        size_t count = xs.size();
+        const __float128 *wp = weights.empty() ? nullptr : weights.data();
+        // Sprawdzenie przed uruchomieniem wątków: błędna próbka kończy się wyjątkiem
+        // w wątku wywołującym, a sumy pozostają bez zmian
+        checkSamples(xs.data(), count);
+        // Wątek dopiero przy co najmniej ok. 16 tys. próbek na wątek i więcej niż n próbkach
+        // (łączenie akumulatorów kosztuje O(n))
+        size_t chunks = min<size_t>({(size_t) workerCount(threads), max<size_t>(1, count / 16384),
+                                     max<size_t>(1, count / x.size())});
+        vector<SplineRegression> partial(chunks - 1, SplineRegression(x));
+        parallelChunks(count, chunks, [&](size_t t, size_t first, size_t last) {
+            SplineRegression &target = t == 0 ? *this : partial[t - 1];
+            target.accumulate(xs.data() + first, ys.data() + first, last - first,
+                              wp ? wp + first : nullptr);
+        });
+        for (auto &p : partial)
+            merge(p);
+    }
+
+    // Dodanie sum z akumulatora o tych samych węzłach
+    void merge(const SplineRegression &other) {
+        if (other.x != x)
+            throw std::invalid_argument("Łączone akumulatory mają różne węzły");
+        for (size_t r = 0; r < rhs.size(); r++) {
+            rhs[r] += other.rhs[r];
+            for (int o = 0; o < 4; o++)
+                gram[r][o] += other.gram[r][o];
+        }
+        samples += other.samples;
+    }
+
+    size_t sampleCount() const {
+        return samples;
+    }
+
+    // Rozwiązanie równań normalnych (LDL^T pasma) i splajn przez wartości S(x[i])
+    NaturalCubicSpline solve() const {
+        int n = x.size();
+        // l[j][o] = L(j+o, j), o = 1..3
+        vector<array<__float128, 4>> l(n);
+        vector<__float128> d(n), c(n);
+        for (int j = 0; j < n; j++) {
+            __float128 dj = gram[j][0];
+            for (int k = max(j - 3, 0); k < j; k++)
+                dj -= l[k][j - k] * l[k][j - k] * d[k];
+            // Brak próbek w którymś fragmencie zakresu – macierz (prawie) osobliwa
+            if (!(dj > gram[j][0] * 1e-28Q))
+                throw std::invalid_argument("Za mało próbek do wyznaczenia splajnu regresyjnego");
+            d[j] = dj;
+            for (int i = j + 1; i <= min(j + 3, n - 1); i++) {
+                __float128 v = gram[j][i - j];
+                for (int k = max(i - 3, 0); k < j; k++)
+                    v -= l[k][i - k] * l[k][j - k] * d[k];
+                l[j][i - j] = v / dj;
+            }
+        }
+        for (int j = 0; j < n; j++) {
+            __float128 v = rhs[j];
+            for (int k = max(j - 3, 0); k < j; k++)
+                v -= l[k][j - k] * c[k];
+            c[j] = v;
+        }
+        for (int j = n - 1; j >= 0; j--) {
+            __float128 v = c[j] / d[j];
+            for (int i = j + 1; i <= min(j + 3, n - 1); i++)
+                v -= l[j][i - j] * c[i];
+            c[j] = v;
+        }
+        // S jest naturalnym splajnem o węzłach x, więc wyznaczają go wartości w węzłach
+        vector<__float128> values(n);
+        for (int i = 0; i < n; i++) {
+            int seg = min(i, n - 2);
+            __float128 val[4], v = 0.0Q;
+            basis(seg, x[i], val);
+            for (int a = 0; a < 4; a++) {
+                int r = seg + a - 1;
+                if (r >= 0 && r < n) v += val[a] * c[r];
+            }
+            values[i] = v;
+        }
+        return NaturalCubicSpline(x, values);
+    }
+};
+
+// ====================
+// Dla trybu 2 i 3 (arytmetyka przedziałowa)
+// ====================
+
+// Konstruktor przedziału ze skalara (obustronnie taki sam)
+Interval I(__float128 v) {
+    Interval r; r.lo = v; r.hi = v; return r;
+}
+
+// Działania przedziałowe z zaokrągleniem na zewnątrz. Górne granice liczone są w FE_UPWARD,
+// a dolne w tym samym trybie jako -(górna granica wartości przeciwnej) (AddDown itd.
+// z interval.h). Wersje *Scoped zakładają, że FE_UPWARD jest już ustawiony (ciąg działań
+// w jednym zakresie zaokrąglania); add, subInt, mul i divInt same ustawiają tryb i – tak
+// jak sqr i pown – przywracają na końcu FE_TONEAREST, więc kosztują dwie zmiany trybu.
+static inline Interval addScoped(const Interval &a, const Interval &b) {
+    Interval r;
+    r.lo = interval_arithmetic::AddDown(a.lo, b.lo);
+    r.hi = a.hi + b.hi;
+    return r;
+}
+
+static inline Interval subScoped(const Interval &a, const Interval &b) {
+    // odejmowanie: [a.lo - b.hi, a.hi - b.lo]
+    Interval r;
+    r.lo = interval_arithmetic::SubDown(a.lo, b.hi);
+    r.hi = a.hi - b.lo;
+    return r;
+}
+
+static inline Interval mulScoped(const Interval &a, const Interval &b) {
+    using interval_arithmetic::MulDown;
+    __float128 p1 = MulDown(a.lo, b.lo);
+    __float128 p2 = MulDown(a.lo, b.hi);
+    __float128 p3 = MulDown(a.hi, b.lo);
+    __float128 p4 = MulDown(a.hi, b.hi);
+    Interval r;
+    r.lo = p1;
+    if (p2 < r.lo) r.lo = p2;
+    if (p3 < r.lo) r.lo = p3;
+    if (p4 < r.lo) r.lo = p4;
+    p1 = a.lo * b.lo;
+    p2 = a.lo * b.hi;
+    p3 = a.hi * b.lo;
+    p4 = a.hi * b.hi;
+    r.hi = p1;
+    if (p2 > r.hi) r.hi = p2;
+    if (p3 > r.hi) r.hi = p3;
+    if (p4 > r.hi) r.hi = p4;
+    return r;
+}
+
+// Wywołujący sprawdza, że b nie zawiera zera
+static inline Interval divScoped(const Interval &a, const Interval &b) {
+    using interval_arithmetic::DivDown;
+    __float128 p1 = DivDown(a.lo, b.lo);
+    __float128 p2 = DivDown(a.lo, b.hi);
+    __float128 p3 = DivDown(a.hi, b.lo);
+    __float128 p4 = DivDown(a.hi, b.hi);
+    Interval r;
+    r.lo = p1;
+    if (p2 < r.lo) r.lo = p2;
+    if (p3 < r.lo) r.lo = p3;
+    if (p4 < r.lo) r.lo = p4;
+    p1 = a.lo / b.lo;
+    p2 = a.lo / b.hi;
+    p3 = a.hi / b.lo;
+    p4 = a.hi / b.hi;
+    r.hi = p1;
+    if (p2 > r.hi) r.hi = p2;
+    if (p3 > r.hi) r.hi = p3;
+    if (p4 > r.hi) r.hi = p4;
+    return r;
+}
+
+// Kwadrat [mig^2, mag^2] i sześcian (funkcja rosnąca) – te same wyniki co sqr i pown(a, 3)
+static inline Interval sqrScoped(const Interval &a) {
+    __float128 mig = a.lo > 0 ? a.lo : (a.hi < 0 ? -a.hi : 0.0Q);
+    __float128 mag = fmaxq(fabsq(a.lo), fabsq(a.hi));
+    Interval r;
+    r.lo = interval_arithmetic::MulDown(mig, mig);
+    r.hi = mag * mag;
+    return r;
+}
+
+static inline Interval cubeScoped(const Interval &a) {
+    using interval_arithmetic::MulDown;
+    // v^3 dla v >= 0 zaokrąglone w dół i w górę; dla ujemnych końców -(|v|^3) w przeciwną stronę
+    auto down = [](__float128 v) { return MulDown(v, MulDown(v, v)); };
+    auto up = [](__float128 v) { return v * (v * v); };
+    Interval r;
+    r.lo = a.lo >= 0 ? down(a.lo) : -up(-a.lo);
+    r.hi = a.hi >= 0 ? up(a.hi) : -down(-a.hi);
+    return r;
+}
+
+Interval add(const Interval &a, const Interval &b) {
+    fesetround(FE_UPWARD);
+    Interval r = addScoped(a, b);
+    fesetround(FE_TONEAREST);
+    return r;
+}
+
+Interval subInt(const Interval &a, const Interval &b) {
+    fesetround(FE_UPWARD);
+    Interval r = subScoped(a, b);
+    fesetround(FE_TONEAREST);
+    return r;
+}
+
+Interval mul(const Interval &a, const Interval &b) {
+    fesetround(FE_UPWARD);
+    Interval r = mulScoped(a, b);
+    fesetround(FE_TONEAREST);
+    return r;
+}
+
+Interval divInt(const Interval &a, const Interval &b) {
+    // Sprawdzamy, czy przedział b zawiera zero
+    if (b.lo <= 0 && b.hi >= 0) {
+        throw std::invalid_argument("Dzielenie przez przedział zawierający zero");
+    }
+    fesetround(FE_UPWARD);
+    Interval r = divScoped(a, b);
+    fesetround(FE_TONEAREST);
+    return r;
+}
+
+// Potęga p nieujemnej podstawy z zaokrągleniem ustawionym przez wywołującego
+// (szybkie potęgowanie – log2(p) mnożeń zamiast p-1)
+static inline __float128 powRounded(__float128 base, unsigned int p) {
+    __float128 r = 1.0Q;
+    while (p > 0) {
+        if (p & 1u) r *= base;
+        base *= base;
+        p >>= 1;
+    }
+    return r;
+}
+
+// Kwadrat przedziału z zaokrągleniem na zewnątrz (odpowiednik DISqr z interval.h).
+// Dla przedziału zawierającego zero dolna granica wynosi 0, a nie ujemny iloczyn lo*hi.
+Interval sqr(const Interval &a) {
+    __float128 mig, mag;
+    if (a.lo <= 0 && a.hi >= 0)
+        mig = 0.0Q;
+    else if (a.lo > 0)
+        mig = a.lo;
+    else
+        mig = -a.hi;
+    mag = fabsq(a.lo) > fabsq(a.hi) ? fabsq(a.lo) : fabsq(a.hi);
+    Interval r;
+    fesetround(FE_DOWNWARD);
+    r.lo = mig * mig;
+    fesetround(FE_UPWARD);
+    r.hi = mag * mag;
+    fesetround(FE_TONEAREST);
+    return r;
+}
+
+// Potęga całkowita przedziału z zaokrągleniem na zewnątrz.
+// Dla parzystego p wynik to [mig^p, mag^p], dla nieparzystego funkcja jest monotoniczna.
+Interval pown(const Interval &a, int p) {
+    if (p == 0) return I(1.0Q);
+    if (p < 0) return divInt(I(1.0Q), pown(a, -p));
+    if (p == 1) return a;
+    if (p == 2) return sqr(a);
+    unsigned int up = (unsigned int) p;
+    Interval r;
+    if ((up & 1u) == 0) {
+        __float128 mig, mag;
+        if (a.lo <= 0 && a.hi >= 0)
+            mig = 0.0Q;
+        else if (a.lo > 0)
+            mig = a.lo;
+        else
+            mig = -a.hi;
+        mag = fabsq(a.lo) > fabsq(a.hi) ? fabsq(a.lo) : fabsq(a.hi);
+        fesetround(FE_DOWNWARD);
+        r.lo = powRounded(mig, up);
+        fesetround(FE_UPWARD);
+        r.hi = powRounded(mag, up);
+    } else {
+        // Dla ujemnej podstawy x^p = -(|x|^p), więc kierunek zaokrąglenia się odwraca
+        fesetround(FE_DOWNWARD);
+        r.lo = a.lo >= 0 ? powRounded(a.lo, up) : 0.0Q;
+        r.hi = a.hi < 0 ? -powRounded(-a.hi, up) : 0.0Q;
+        fesetround(FE_UPWARD);
+        if (a.lo < 0) r.lo = -powRounded(-a.lo, up);
+        if (a.hi >= 0) r.hi = powRounded(a.hi, up);
+    }
+    fesetround(FE_TONEAREST);
+    return r;
+}
+
+// Wersja wsadowa sqr: wszystkie dolne granice w jednym przebiegu FE_DOWNWARD,
+// wszystkie górne w jednym przebiegu FE_UPWARD. Wewnątrz pętli nie ma zmian trybu
+// zaokrąglenia, a jedyne rozgałęzienia to wybór min/max (kandydaci do cmov/blend).
+void sqrBatch(const Interval *in, Interval *out, size_t count) {
+    fesetround(FE_DOWNWARD);
+    for (size_t i = 0; i < count; i++) {
+        __float128 lo = in[i].lo, hi = in[i].hi;
+        __float128 mig = lo > 0 ? lo : (hi < 0 ? -hi : 0.0Q);
+        out[i].lo = mig * mig;
+    }
+    fesetround(FE_UPWARD);
+    for (size_t i = 0; i < count; i++) {
+        __float128 lo = fabsq(in[i].lo), hi = fabsq(in[i].hi);
+        __float128 mag = lo > hi ? lo : hi;
+        out[i].hi = mag * mag;
+    }
+    fesetround(FE_TONEAREST);
+}
+
+// Wersja wsadowa pown – jeden przebieg na kierunek zaokrąglenia
+void pownBatch(const Interval *in, Interval *out, size_t count, int p) {
+    if (p == 2) {
+        sqrBatch(in, out, count);
+        return;
+    }
+    if (p < 2) {
+        for (size_t i = 0; i < count; i++) out[i] = pown(in[i], p);
+        return;
+    }
+    unsigned int up = (unsigned int) p;
+    bool even = (up & 1u) == 0;
+    fesetround(FE_DOWNWARD);
+    for (size_t i = 0; i < count; i++) {
+        __float128 lo = in[i].lo, hi = in[i].hi;
+        if (even) {
+            __float128 mig = lo > 0 ? lo : (hi < 0 ? -hi : 0.0Q);
+            out[i].lo = powRounded(mig, up);
+        } else {
+            if (lo >= 0) out[i].lo = powRounded(lo, up);
+            if (hi < 0) out[i].hi = -powRounded(-hi, up);
+        }
+    }
+    fesetround(FE_UPWARD);
+    for (size_t i = 0; i < count; i++) {
+        __float128 lo = in[i].lo, hi = in[i].hi;
+        if (even) {
+            __float128 mag = fabsq(lo) > fabsq(hi) ? fabsq(lo) : fabsq(hi);
+            out[i].hi = powRounded(mag, up);
+        } else {
+            if (lo < 0) out[i].lo = -powRounded(-lo, up);
+            if (hi >= 0) out[i].hi = powRounded(hi, up);
+        }
+    }
+    fesetround(FE_TONEAREST);
+}
+
+// Funkcja pomocnicza do wypisywania przedziału jako string "[lo, hi]"
+string toString(const Interval &a) {
+    char bufLo[128], bufHi[128];
+    quadmath_snprintf(bufLo, sizeof(bufLo), "%.18Qe", a.lo);
+    quadmath_snprintf(bufHi, sizeof(bufHi), "%.18Qe", a.hi);
+    string s = "[";
+    s += bufLo; s += ", "; s += bufHi; s += "]";
+    return s;
+}
+
+struct IntervalSplineSegment {
+    Interval a, b, c, d; // współczynniki lokalne
+    Interval x;          // początek przedziału
+    // współczynniki globalne
+    Interval a0, a1, a2, a3;
+};
+
+// Wypisanie współczynników globalnych segmentów przedziałowych (wspólne dla trybów 2–4)
+void printIntervalCoefficients(const vector<IntervalSplineSegment> &segments, ofstream &outputFile) {
+    const int numCoeff = 4; 
+    int numSegments = segments.size();
+    for (int coeff = 0; coeff < numCoeff; coeff++) {
+        for (int seg = 0; seg < numSegments; seg++) {
+            Interval val;
+            if (coeff == 0)       val = segments[seg].a0;
+            else if (coeff == 1)  val = segments[seg].a1;
+            else if (coeff == 2)  val = segments[seg].a2;
+            else                  val = segments[seg].a3;
+            
+            // Wypisz przedział
+            outputFile << "a[" << coeff << "," << seg << "] = ";
+            IEndsToString(val, outputFile);
+            outputFile << "\n";
+            
+            // Oblicz i wypisz szerokość w formacie X.Xe+X
+            __float128 width = IntWidth(val);
+            char widthBuffer[128];
+            quadmath_snprintf(widthBuffer, sizeof(widthBuffer), "%.1Qe", width);
+            outputFile << "width = " << widthBuffer << "\n\n";
+        }
+    }
+}
+
+// ====================
+// Zweryfikowane rozwiązanie przedziałowego układu trójdiagonalnego
+// ====================
+// Układ sub[i]*c[i-1] + diag[i]*c[i] + sup[i]*c[i+1] = rhs[i], i = 0..m-1 (sub[0] i sup[m-1]
+// są pomijane, a w układzie cyklicznym sprzęgają c[0] z c[m-1]). Eliminacja Gaussa na przedziałach poszerza wyniki i przerywa się, gdy
+// piwot l[i] zawiera zero, a jej zaokrąglenia nie są kierowane. Tutaj obwiednia jest
+// wyznaczana z kierowanym zaokrągleniem w czasie O(m), a potem zawężana przebiegiem
+// przedziałowej metody Gaussa-Seidla.
+
+// Moduł przedziału (mag) i jego najmniejsza wartość bezwzględna (mig)
+static inline __float128 magnitude(const Interval &a) {
+    return fmaxq(fabsq(a.lo), fabsq(a.hi));
+}
+
+static inline __float128 mignitude(const Interval &a) {
+    if (a.lo <= 0 && a.hi >= 0) return 0.0Q;
+    return fminq(fabsq(a.lo), fabsq(a.hi));
+}
+
+// Najmniejszy z iloczynów końców; przy FE_DOWNWARD jest to dolna granica iloczynu a*b
+static inline __float128 minProduct(const Interval &a, const Interval &b) {
+    return fminq(fminq(a.lo * b.lo, a.lo * b.hi), fminq(a.hi * b.lo, a.hi * b.hi));
+}
+
+// Algorytm Thomasa dla M-macierzy tridiag(-a, d, -s) i dwóch nieujemnych prawych stron p, q
+// (jedna faktoryzacja na obie). Wszystkie wielkości pośrednie są nieujemne, więc przy
+// FE_UPWARD wyniki są górnymi, a przy FE_DOWNWARD dolnymi ograniczeniami M^-1*p i M^-1*q
+// (piwot l liczony jako -(a*mu - d), żeby był zaokrąglony w przeciwną stronę).
+// Faktoryzacja zależy tylko od macierzy, więc jest liczona osobno i może obsłużyć wiele
+// prawych stron – w tym samym trybie zaokrąglenia, w którym powstała.
+struct MonotoneFactor {
+    vector<__float128> a, mu, inv;
+};
+
+// Zwraca false, gdy piwot nie jest dodatni
+static bool factorMonotone(const vector<__float128> &a, const vector<__float128> &d,
+                           const vector<__float128> &s, MonotoneFactor &f) {
+    size_t m = d.size();
+    f.a = a;
+    f.mu.resize(m);
+    f.inv.resize(m);
+    for (size_t i = 0; i < m; i++) {
+        __float128 l = i > 0 ? -(a[i] * f.mu[i - 1] - d[i]) : d[i];
+        if (!(l > 0)) return false;
+        // 1/l zaokrąglone w tym samym kierunku co reszta – jedno dzielenie na wiersz
+        f.inv[i] = 1.0Q / l;
+        f.mu[i] = s[i] * f.inv[i];
+    }
+    return true;
+}
+
+static void applyMonotone(const MonotoneFactor &f, const vector<__float128> &p,
+                          const vector<__float128> &q, vector<__float128> &x,
+                          vector<__float128> &y) {
+    size_t m = f.inv.size();
+    x.resize(m);
+    y.resize(m);
+    for (size_t i = 0; i < m; i++) {
+        x[i] = (i > 0 ? p[i] + f.a[i] * x[i - 1] : p[i]) * f.inv[i];
+        y[i] = (i > 0 ? q[i] + f.a[i] * y[i - 1] : q[i]) * f.inv[i];
+    }
+    for (size_t i = m - 1; i-- > 0;) {
+        x[i] += f.mu[i] * x[i + 1];
+        y[i] += f.mu[i] * y[i + 1];
+    }
+}
+
+// Macierz układu wraz z faktoryzacjami obwiedni monotonicznej – część rozwiązania
+// niezależna od prawej strony
+struct TridiagonalFactor {
+    vector<Interval> sub, diag, sup;
+    bool cyclic = false;          // sub[0] i sup[m-1] to narożniki macierzy (m >= 2)
+    bool monotone = false;        // up i down są ważne (macierz po zmianie znaków to M-macierz)
+    MonotoneFactor up, down;      // Mlo (FE_UPWARD) i Mhi (FE_DOWNWARD)
+};
+
+// Obwiednia dla diag > 0 i sub, sup > 0 (układ splajnu przy rosnących węzłach): po zmianie
+// znaków co drugiej niewiadomej (y = D*c, D = diag((-1)^i)) macierz D*A*D jest przedziałową
+// M-macierzą, a M^-1 >= 0 maleje względem M. Stąd
+// y <= Mlo^-1 * b'hi+ - Mhi^-1 * b'hi-  oraz  y >= Mhi^-1 * b'lo+ - Mlo^-1 * b'lo-,
+// gdzie b' = D*rhs, a v+ i v- to części dodatnia i ujemna wektora v.
+// Dla układu cyklicznego obwiedni monotonicznej nie ma (narożniki psują trójdiagonalną
+// eliminację) i rozwiązanie idzie przez tridiagonalResidualBound.
+static void factorTridiagonal(const vector<Interval> &sub, const vector<Interval> &diag,
+                              const vector<Interval> &sup, TridiagonalFactor &f,
+                              bool cyclic = false) {
+    size_t m = diag.size();
+    f.sub = sub;
+    f.diag = diag;
+    f.sup = sup;
+    f.cyclic = cyclic;
+    f.monotone = false;
+    if (cyclic) return;
+    vector<__float128> aLo(m), aHi(m), dLo(m), dHi(m), sLo(m), sHi(m);
+    for (size_t i = 0; i < m; i++) {
+        if (!(diag[i].lo > 0)) return;
+        if (i > 0 && !(sub[i].lo > 0)) return;
+        if (i + 1 < m && !(sup[i].lo > 0)) return;
+        aLo[i] = i > 0 ? sub[i].lo : 0.0Q;
+        aHi[i] = i > 0 ? sub[i].hi : 0.0Q;
+        sLo[i] = i + 1 < m ? sup[i].lo : 0.0Q;
+        sHi[i] = i + 1 < m ? sup[i].hi : 0.0Q;
+        dLo[i] = diag[i].lo;
+        dHi[i] = diag[i].hi;
+    }
+    fesetround(FE_UPWARD);
+    bool ok = factorMonotone(aHi, dLo, sHi, f.up);
+    fesetround(FE_DOWNWARD);
+    ok = ok && factorMonotone(aLo, dHi, sLo, f.down);
+    fesetround(FE_TONEAREST);
+    f.monotone = ok;
+}
+
+static bool tridiagonalMonotoneBound(const TridiagonalFactor &f, const vector<Interval> &rhs,
+                                     vector<Interval> &c) {
+    if (!f.monotone) return false;
+    size_t m = rhs.size();
+    vector<__float128> hiPos(m), hiNeg(m), loPos(m), loNeg(m);
+    for (size_t i = 0; i < m; i++) {
+        __float128 bLo = (i & 1) ? -rhs[i].hi : rhs[i].lo;
+        __float128 bHi = (i & 1) ? -rhs[i].lo : rhs[i].hi;
+        hiPos[i] = fmaxq(bHi, 0.0Q);
+        hiNeg[i] = fmaxq(-bHi, 0.0Q);
+        loPos[i] = fmaxq(bLo, 0.0Q);
+        loNeg[i] = fmaxq(-bLo, 0.0Q);
+    }
+    vector<__float128> upHi, upLo, downHi, downLo;
+    fesetround(FE_UPWARD);
+    applyMonotone(f.up, hiPos, loNeg, upHi, upLo);
+    fesetround(FE_DOWNWARD);
+    applyMonotone(f.down, hiNeg, loPos, downHi, downLo);
+    for (size_t i = 0; i < m; i++) {
+        __float128 yLo = downLo[i] - upLo[i];
+        if (i & 1) c[i].hi = -yLo; else c[i].lo = yLo;
+    }
+    fesetround(FE_UPWARD);
+    for (size_t i = 0; i < m; i++) {
+        __float128 yHi = upHi[i] - downHi[i];
+        if (i & 1) c[i].lo = -yHi; else c[i].hi = yHi;
+    }
+    fesetround(FE_TONEAREST);
+    return true;
+}
+
+// Obwiednia w ogólnym przypadku macierzy ściśle diagonalnie dominującej: przybliżenie ct
+// dla środków przedziałów i ograniczenie jego błędu e = c - ct, który spełnia A*e = r,
+// r = rhs - A*ct. Ponieważ |A^-1| <= <A>^-1 (<A> – macierz porównawcza: mig na diagonali,
+// -mag poza nią), |e| <= u dla każdego u >= 0 z <A>*u >= mag(r). Startujemy od ograniczenia
+// Varaha i zawężamy je iteracją Gaussa-Seidla na <A> (każda iteracja zachowuje nierówność).
+// W układzie cyklicznym sąsiadami wierszy 0 i m-1 są odpowiednio c[m-1] i c[0].
+static bool tridiagonalResidualBound(const TridiagonalFactor &f, const vector<Interval> &rhs,
+                                     vector<Interval> &c) {
+    const vector<Interval> &sub = f.sub, &diag = f.diag, &sup = f.sup;
+    size_t m = diag.size();
+    vector<__float128> subMid(m), diagMid(m), supMid(m), rhsMid(m), ct;
+    for (size_t i = 0; i < m; i++) {
+        subMid[i] = sub[i].lo / 2.0Q + sub[i].hi / 2.0Q;
+        diagMid[i] = diag[i].lo / 2.0Q + diag[i].hi / 2.0Q;
+        supMid[i] = sup[i].lo / 2.0Q + sup[i].hi / 2.0Q;
+        rhsMid[i] = rhs[i].lo / 2.0Q + rhs[i].hi / 2.0Q;
+    }
+    if (f.cyclic)
+        cyclicSolve(subMid, diagMid, supMid, rhsMid, ct);
+    else
+        thomasSolve(subMid, diagMid, supMid, rhsMid, ct);
+    auto hasPrev = [&](size_t i) { return i > 0 || f.cyclic; };
+    auto hasNext = [&](size_t i) { return i + 1 < m || f.cyclic; };
+    auto prev = [m](size_t i) { return i > 0 ? i - 1 : m - 1; };
+    auto next = [m](size_t i) { return i + 1 < m ? i + 1 : 0; };
+    // Residuum: dolne granice w jednym przebiegu FE_DOWNWARD, górne w FE_UPWARD.
+    // -max(a.lo*t, a.hi*t) = min(a.lo*(-t), a.hi*(-t)), więc obie granice mają tę samą postać.
+    vector<__float128> rLo(m), rMag(m), slack(m);
+    fesetround(FE_DOWNWARD);
+    for (size_t i = 0; i < m; i++) {
+        __float128 acc = rhs[i].lo + fminq(diag[i].lo * -ct[i], diag[i].hi * -ct[i]);
+        if (hasPrev(i)) acc += fminq(sub[i].lo * -ct[prev(i)], sub[i].hi * -ct[prev(i)]);
+        if (hasNext(i)) acc += fminq(sup[i].lo * -ct[next(i)], sup[i].hi * -ct[next(i)]);
+        rLo[i] = acc;
+        // Nadwyżka diagonalna mig(A_ii) - mag(A_i,i-1) - mag(A_i,i+1) zaokrąglona w dół
+        __float128 s = mignitude(diag[i]);
+        if (hasPrev(i)) s -= magnitude(sub[i]);
+        if (hasNext(i)) s -= magnitude(sup[i]);
+        slack[i] = s;
+    }
+    fesetround(FE_UPWARD);
+    __float128 rNorm = 0.0Q;
+    for (size_t i = 0; i < m; i++) {
+        __float128 acc = rhs[i].hi + fmaxq(diag[i].lo * -ct[i], diag[i].hi * -ct[i]);
+        if (hasPrev(i)) acc += fmaxq(sub[i].lo * -ct[prev(i)], sub[i].hi * -ct[prev(i)]);
+        if (hasNext(i)) acc += fmaxq(sup[i].lo * -ct[next(i)], sup[i].hi * -ct[next(i)]);
+        rMag[i] = fmaxq(fabsq(rLo[i]), fabsq(acc));
+        rNorm = fmaxq(rNorm, rMag[i]);
+    }
+    __float128 gamma = *min_element(slack.begin(), slack.end());
+    if (!(gamma > 0)) {
+        fesetround(FE_TONEAREST);
+        return false;
+    }
+    // u[i] = (mag(r[i]) + mag(sub[i])*u[i-1] + mag(sup[i])*u[i+1]) / mig(diag[i]), w górę
+    vector<__float128> u(m, rNorm / gamma);
+    auto relax = [&](size_t i) {
+        __float128 acc = rMag[i];
+        if (hasPrev(i)) acc += magnitude(sub[i]) * u[prev(i)];
+        if (hasNext(i)) acc += magnitude(sup[i]) * u[next(i)];
+        u[i] = fminq(u[i], acc / mignitude(diag[i]));
+    };
+    const int maxSweeps = 8;
+    for (int sweep = 0; sweep < maxSweeps; sweep++) {
+        __float128 before = 0.0Q, after = 0.0Q;
+        for (size_t i = 0; i < m; i++) before += u[i];
+        for (size_t i = 0; i < m; i++) relax(i);
+        for (size_t i = m; i-- > 0;) relax(i);
+        for (size_t i = 0; i < m; i++) after += u[i];
+        // Koniec, gdy przebieg zawęża ograniczenie o mniej niż 1/64
+        if (after >= before - before / 64.0Q) break;
+    }
+    for (size_t i = 0; i < m; i++) c[i].hi = ct[i] + u[i];
+    fesetround(FE_DOWNWARD);
+    for (size_t i = 0; i < m; i++) c[i].lo = ct[i] - u[i];
+    fesetround(FE_TONEAREST);
+    return true;
+}
+
+// Obwiednia wszystkich rozwiązań układu dla macierzy i prawych stron z podanych przedziałów
+vector<Interval> solveTridiagonalVerified(const TridiagonalFactor &f, const vector<Interval> &rhs) {
+    const vector<Interval> &sub = f.sub, &diag = f.diag, &sup = f.sup;
+    size_t m = diag.size();
+    vector<Interval> c(m);
+    if (m == 0) return c;
+    if (!tridiagonalMonotoneBound(f, rhs, c) &&
+        !tridiagonalResidualBound(f, rhs, c))
+        throw std::invalid_argument("Macierz układu nie jest diagonalnie dominująca – nie można zweryfikować rozwiązania");
+    // Przebieg przedziałowej metody Gaussa-Seidla (zachowuje znaki składników):
+    // c[i] = c[i] ∩ (rhs[i] - sub[i]*c[i-1] - sup[i]*c[i+1]) / diag[i].
+    // Górne granice liczone są jako -(dolna granica wartości przeciwnej), więc cały
+    // przebieg idzie w FE_DOWNWARD.
+    fesetround(FE_DOWNWARD);
+    for (size_t i = 0; i < m; i++) {
+        if (!(mignitude(diag[i]) > 0)) continue;
+        Interval negSub = {-sub[i].hi, -sub[i].lo}, negSup = {-sup[i].hi, -sup[i].lo};
+        __float128 tLo = rhs[i].lo, tHiNeg = -rhs[i].hi;
+        if (i > 0 || f.cyclic) {
+            const Interval &cp = c[i > 0 ? i - 1 : m - 1];
+            tLo += minProduct(negSub, cp);
+            tHiNeg += minProduct(sub[i], cp);
+        }
+        if (i + 1 < m || f.cyclic) {
+            const Interval &cn = c[i + 1 < m ? i + 1 : 0];
+            tLo += minProduct(negSup, cn);
+            tHiNeg += minProduct(sup[i], cn);
+        }
+        const Interval &d = diag[i];
+        __float128 gLo, gHiNeg;
+        if (d.lo > 0) {
+            // Dodatni mianownik: dolna granica t/d to t.lo/d.hi albo t.lo/d.lo zależnie od znaku
+            gLo = tLo / (tLo >= 0 ? d.hi : d.lo);
+            gHiNeg = tHiNeg / (tHiNeg >= 0 ? d.hi : d.lo);
+        } else {
+            gLo = fminq(fminq(tLo / d.lo, tLo / d.hi), fminq(-tHiNeg / d.lo, -tHiNeg / d.hi));
+            gHiNeg = fminq(fminq(-tLo / d.lo, -tLo / d.hi), fminq(tHiNeg / d.lo, tHiNeg / d.hi));
+        }
+        c[i].lo = fmaxq(c[i].lo, gLo);
+        c[i].hi = fminq(c[i].hi, -gHiNeg);
+    }
+    fesetround(FE_TONEAREST);
+    return c;
+}
+
+vector<Interval> solveTridiagonalVerified(const vector<Interval> &sub, const vector<Interval> &diag,
+                                          const vector<Interval> &sup, const vector<Interval> &rhs) {
+    TridiagonalFactor f;
+    factorTridiagonal(sub, diag, sup, f);
+    return solveTridiagonalVerified(f, rhs);
+}
+
+// Układ tridiag(1, 4, 1)*c = rhs siatki równomiernej. Macierz jest punktowa, więc obwiednia
+// z tridiagonalMonotoneBound jest od razu hullem zbioru rozwiązań (z dokładnością do
+// zaokrągleń) i nie wymaga zawężania; piwoty w obu kierunkach zaokrąglenia daje
+// uniformPivots, a eliminacja nie wykonuje dzieleń.
+static void thomasUniform(const vector<__float128> &inv, const vector<__float128> &p,
+                          const vector<__float128> &q, vector<__float128> &x,
+                          vector<__float128> &y) {
+    size_t m = p.size(), last = inv.size() - 1;
+    x.resize(m);
+    y.resize(m);
+    for (size_t i = 0; i < m; i++) {
+        __float128 w = inv[min(i, last)];
+        x[i] = (i > 0 ? p[i] + x[i - 1] : p[i]) * w;
+        y[i] = (i > 0 ? q[i] + y[i - 1] : q[i]) * w;
+    }
+    for (size_t i = m - 1; i-- > 0;) {
+        __float128 w = inv[min(i, last)];
+        x[i] += w * x[i + 1];
+        y[i] += w * y[i + 1];
+    }
+}
+
+// invUp, invDown – uniformPivots policzone w FE_UPWARD i FE_DOWNWARD
+vector<Interval> solveUniformVerified(const vector<__float128> &invUp,
+                                      const vector<__float128> &invDown,
+                                      const vector<Interval> &rhs) {
+    size_t m = rhs.size();
+    vector<Interval> c(m);
+    if (m == 0) return c;
+    // Po zmianie znaków co drugiej niewiadomej macierz to M = tridiag(-1, 4, -1), M^-1 >= 0
+    vector<__float128> hiPos(m), hiNeg(m), loPos(m), loNeg(m);
+    for (size_t i = 0; i < m; i++) {
+        __float128 bLo = (i & 1) ? -rhs[i].hi : rhs[i].lo;
+        __float128 bHi = (i & 1) ? -rhs[i].lo : rhs[i].hi;
+        hiPos[i] = fmaxq(bHi, 0.0Q);
+        hiNeg[i] = fmaxq(-bHi, 0.0Q);
+        loPos[i] = fmaxq(bLo, 0.0Q);
+        loNeg[i] = fmaxq(-bLo, 0.0Q);
+    }
+    vector<__float128> upHi, upLo, downHi, downLo;
+    fesetround(FE_UPWARD);
+    thomasUniform(invUp, hiPos, loNeg, upHi, upLo);
+    fesetround(FE_DOWNWARD);
+    thomasUniform(invDown, hiNeg, loPos, downHi, downLo);
+    for (size_t i = 0; i < m; i++) {
+        __float128 yLo = downLo[i] - upLo[i];
+        if (i & 1) c[i].hi = -yLo; else c[i].lo = yLo;
+    }
+    fesetround(FE_UPWARD);
+    for (size_t i = 0; i < m; i++) {
+        __float128 yHi = upHi[i] - downHi[i];
+        if (i & 1) c[i].lo = -yHi; else c[i].hi = yHi;
+    }
+    fesetround(FE_TONEAREST);
+    return c;
+}
+
+// Część dopasowania splajnu przedziałowego zależna tylko od węzłów: h, macierz układu z jej
+// faktoryzacjami (albo piwoty siatki równomiernej), 6*h i potęgi węzłów do postaci
+// globalnej. Liczona raz, obsługuje dowolnie wiele wektorów y (np. zaburzenia Monte Carlo),
+// a fit wykonuje już tylko część zależną od y. Wynik fit jest identyczny z konstruktorem
+// NaturalCubicSplineInterval(x, y) (dla tych samych warunków brzegowych).
+class IntervalSplineFactor {
+private:
+    vector<Interval> x, h, sixH, x2, x3;
+    IntervalKnotIndex index;
+    SplineBoundary<Interval> boundary;
+    bool uniform = false;
+    Interval scale;                            // 6/h^2 siatki równomiernej
+    vector<__float128> pivotsUp, pivotsDown;   // uniformPivots w FE_UPWARD i FE_DOWNWARD
+    TridiagonalFactor system;
+    int first = 1;                             // niewiadoma k układu to c[first + k]
+    // not-a-knot: wagi prawej strony h1/(h0+h1) na obu końcach i ilorazy h0/h1 do
+    // odtworzenia c[0] i c[n-1]
+    Interval weightStart, weightEnd, ratioStart, ratioEnd;
+
+    friend class NaturalCubicSplineInterval;
+    friend class IntervalSplineBatch;
+
+public:
+    // uniformGrid – wywołujący deklaruje, że prawdziwe węzły są równoodległe; bez deklaracji
+    // siatka jest uznawana za równomierną tylko dla węzłów punktowych o dokładnie równych
+    // odstępach.
+    explicit IntervalSplineFactor(const vector<Interval>& x_in, bool uniformGrid = false)
+        : IntervalSplineFactor(x_in, SplineBoundary<Interval>(), uniformGrid) {
+    }
+
+    // Węzły z warunkami brzegowymi bc (nachylenia zamocowania jako przedziały); stały układ
+    // siatki równomiernej dotyczy tylko warunków naturalnych. Wiersze brzegowe jak w
+    // solveBoundary, układ okresowy jest cykliczny.
+    IntervalSplineFactor(const vector<Interval>& x_in, const SplineBoundary<Interval> &bc,
+                         bool uniformGrid = false) {
+        x = x_in;
+        boundary = bc;
+        index.build(x);
+        int n = x.size();
+        h.resize(n - 1);
+        bool exactGrid = n >= 3;
+        for (int i = 0; i < n - 1; i++) {
+            h[i] = subInt(x[i+1], x[i]);
+            // Sprawdzamy, czy h[i] zawiera zero
+            if (h[i].lo <= 0 && h[i].hi >= 0) {
+                throw std::invalid_argument("Przedział h[i] zawiera zero, co uniemożliwia konstrukcję splajnu");
+            }
+            exactGrid = exactGrid && h[i].lo == h[i].hi && h[i].lo == h[0].lo;
+        }
+        if (bc.kind == BOUNDARY_NATURAL && n >= 3 && (uniformGrid || exactGrid)) {
+            // Jeden krok h: należy do każdego h[i] i do (x[n-1] - x[0])/(n-1), więc bierzemy
+            // część wspólną – przy szerokich węzłach jest ona znacznie węższa niż każde h[i]
+            Interval step = divInt( subInt(x[n-1], x[0]), I((__float128) (n - 1)) );
+            for (int i = 0; i < n - 1; i++) {
+                step.lo = fmaxq(step.lo, h[i].lo);
+                step.hi = fminq(step.hi, h[i].hi);
+            }
+            if (step.lo > step.hi)
+                throw std::invalid_argument("Węzły nie tworzą siatki równomiernej");
+            for (int i = 0; i < n - 1; i++) h[i] = step;
+            uniform = true;
+            scale = divInt( I(6.0Q), sqr(step) );
+            fesetround(FE_UPWARD);
+            uniformPivots(pivotsUp);
+            fesetround(FE_DOWNWARD);
+            uniformPivots(pivotsDown);
+            fesetround(FE_TONEAREST);
+        } else {
+            // Układ równań dla c[1..n-2] (naturalny: c[0] = c[n-1] = 0):
+            // h[i-1]*c[i-1] + 2*(x[i+1]-x[i-1])*c[i] + h[i]*c[i+1] = alpha[i]
+            // Zamocowany dochodzi c[0] i c[n-1], okresowy c[0] (c[n-1] = c[0]), a not-a-knot
+            // zmienia pierwszy i ostatni wiersz.
+            int m = max(n - 2, 0);
+            if (bc.kind == BOUNDARY_CLAMPED) {
+                first = 0;
+                m = n;
+            } else if (bc.kind == BOUNDARY_PERIODIC) {
+                first = 0;
+                m = n >= 3 ? n - 1 : 0;
+            } else if (bc.kind == BOUNDARY_NOT_A_KNOT && n < 4) {
+                m = 0;
+            }
+            vector<Interval> sub(m), diag(m), sup(m);
+            for (int k = 0; k < m; k++) {
+                int i = first + k;
+                if (i < 1 || i > n - 2) continue;
+                sub[k] = h[i-1];
+                diag[k] = mul( I(2.0Q), subInt(x[i+1], x[i-1]) );
+                sup[k] = h[i];
+            }
+            if (bc.kind == BOUNDARY_CLAMPED) {
+                diag[0] = mul( I(2.0Q), h[0] );
+                sup[0] = h[0];
+                sub[m-1] = h[n-2];
+                diag[m-1] = mul( I(2.0Q), h[n-2] );
+            } else if (bc.kind == BOUNDARY_PERIODIC && m > 0) {
+                sub[0] = h[n-2];
+                diag[0] = mul( I(2.0Q), add(h[n-2], h[0]) );
+                sup[0] = h[0];
+            } else if (bc.kind == BOUNDARY_NOT_A_KNOT && m > 0) {
+                diag[0] = add( h[0], mul( I(2.0Q), h[1] ) );
+                sup[0] = subInt(h[1], h[0]);
+                sub[m-1] = subInt(h[n-3], h[n-2]);
+                diag[m-1] = add( mul( I(2.0Q), h[n-3] ), h[n-2] );
+                weightStart = divInt( h[1], add(h[0], h[1]) );
+                weightEnd = divInt( h[n-3], add(h[n-3], h[n-2]) );
+                ratioStart = divInt( h[0], h[1] );
+                ratioEnd = divInt( h[n-2], h[n-3] );
+            }
+            factorTridiagonal(sub, diag, sup, system, bc.kind == BOUNDARY_PERIODIC);
+        }
+        sixH.resize(n - 1);
+        for (int i = 0; i < n - 1; i++)
+            sixH[i] = mul( I(6.0Q), h[i] );
+        // Potęgi węzłów potrzebne do postaci globalnej – liczone wsadowo
+        x2.resize(n - 1);
+        x3.resize(n - 1);
+        sqrBatch(x.data(), x2.data(), n - 1);
+        pownBatch(x.data(), x3.data(), n - 1, 3);
+    }
+
+    int size() const {
+        return x.size();
+    }
+
+    // Współczynniki splajnu dla wartości y[0..n-1], zapisane do segments[0..n-2]
+    void fit(const Interval *y, IntervalSplineSegment *segments) const {
+        int n = x.size();
+        vector<Interval> periodicY;
+        if (boundary.kind == BOUNDARY_PERIODIC && n >= 2) {
+            // Oba końce reprezentują tę samą wartość – bierzemy część wspólną
+            Interval common = {fmaxq(y[0].lo, y[n-1].lo), fminq(y[0].hi, y[n-1].hi)};
+            if (common.lo > common.hi)
+                throw std::invalid_argument("Dla warunku okresowego przedziały y[0] i y[n-1] muszą mieć część wspólną");
+            periodicY.assign(y, y + n);
+            periodicY[0] = periodicY[n-1] = common;
+            y = periodicY.data();
+        }
+        // Ilorazy różnicowe (y[i+1]-y[i])/h[i]
+        vector<Interval> slope(max(n - 1, 0));
+        for (int i = 0; i < n - 1; i++)
+            slope[i] = divInt( subInt(y[i+1], y[i]), h[i] );
+        vector<Interval> c(n, I(0.0Q)), b(n - 1, I(0.0Q)), d(n - 1, I(0.0Q));
+        int m = system.diag.size();
+        if (uniform) {
+            // c[i-1] + 4*c[i] + c[i+1] = 6*(y[i+1] - 2*y[i] + y[i-1])/h^2 – każde y występuje
+            // raz, a h tylko w jednym czynniku
+            vector<Interval> rhs(n - 2);
+            for (int i = 1; i < n - 1; i++)
+                rhs[i-1] = mul( scale, subInt( add(y[i+1], y[i-1]), mul( I(2.0Q), y[i] ) ) );
+            vector<Interval> inner = solveUniformVerified(pivotsUp, pivotsDown, rhs);
+            for (int i = 1; i < n - 1; i++) c[i] = inner[i-1];
+        } else if (boundary.kind == BOUNDARY_NOT_A_KNOT && n == 3) {
+            // Jedna parabola przez trzy punkty
+            Interval c0 = divInt( mul( I(2.0Q), subInt(slope[1], slope[0]) ), subInt(x[2], x[0]) );
+            c[0] = c[1] = c[2] = c0;
+        } else if (m > 0) {
+            vector<Interval> alpha(m);
+            for (int k = 0; k < m; k++) {
+                // alpha[i] = 6 * [ (y[i+1]-y[i])/h[i] - (y[i]-y[i-1])/h[i-1] ]
+                int i = first + k;
+                if (i >= 1 && i <= n - 2)
+                    alpha[k] = mul( I(6.0Q), subInt(slope[i], slope[i-1]) );
+            }
+            if (boundary.kind == BOUNDARY_CLAMPED) {
+                alpha[0] = mul( I(6.0Q), subInt(slope[0], boundary.startSlope) );
+                alpha[m-1] = mul( I(6.0Q), subInt(boundary.endSlope, slope[n-2]) );
+            } else if (boundary.kind == BOUNDARY_PERIODIC) {
+                alpha[0] = mul( I(6.0Q), subInt(slope[0], slope[n-2]) );
+            } else if (boundary.kind == BOUNDARY_NOT_A_KNOT) {
+                alpha[0] = mul( weightStart, alpha[0] );
+                alpha[m-1] = mul( weightEnd, alpha[m-1] );
+            }
+            vector<Interval> inner = solveTridiagonalVerified(system, alpha);
+            for (int k = 0; k < m; k++) c[first + k] = inner[k];
+            if (boundary.kind == BOUNDARY_PERIODIC) {
+                c[n-1] = c[0];
+            } else if (boundary.kind == BOUNDARY_NOT_A_KNOT) {
+                // d[0] = d[1]: c[0] = c[1] + (h0/h1)*(c[1] - c[2]), symetrycznie na końcu
+                c[0] = add( c[1], mul( ratioStart, subInt(c[1], c[2]) ) );
+                c[n-1] = add( c[n-2], mul( ratioEnd, subInt(c[n-2], c[n-3]) ) );
+            }
+        }
+        // b, d i postać globalna w jednym zakresie FE_UPWARD (dzielniki 6 i sixH[j] nie
+        // zawierają zera)
+        interval_arithmetic::RoundingScope<__float128> up(FE_UPWARD);
+        for (int j = n - 2; j >= 0; j--) {
+            Interval term = addScoped( c[j+1], mulScoped( I(2.0Q), c[j] ) );
+            b[j] = subScoped( slope[j], divScoped( mulScoped( h[j], term ), I(6.0Q) ) );
+            d[j] = divScoped( subScoped(c[j+1], c[j]), sixH[j] );
+        }
+        // Wypełnienie segmentów – postać lokalna:
+        // S_i(x) = y[i] + b[i]*(x-x[i]) + (c[i]/2)*(x-x[i])^2 + d[i]*(x-x[i])^3.
+        for (int i = 0; i < n - 1; i++) {
+            segments[i].a = y[i];
+            segments[i].b = b[i];
+            segments[i].c = c[i]; // przechowujemy c[i] bez dzielenia przez 2
+            segments[i].d = d[i];
+            segments[i].x = x[i];
+            // Przekształcenie do postaci globalnej:
+            // a₀ = a - b*x + (c*x²)/2 - d*x³
+            Interval temp1 = subScoped( segments[i].a, mulScoped( segments[i].b, x[i] ) );
+            Interval temp2 = divScoped( mulScoped( segments[i].c, x2[i] ), I(2.0Q) );
+            Interval temp3 = mulScoped( segments[i].d, x3[i] );
+            segments[i].a0 = subScoped( addScoped( temp1, temp2 ), temp3 );
+            // a₁ = b - c*x + 3*d*x²
+            segments[i].a1 = addScoped( subScoped( segments[i].b, mulScoped( segments[i].c, x[i] ) ),
+                                        mulScoped( I(3.0Q), mulScoped( segments[i].d, x2[i] ) ) );
+            // a₂ = (c/2) - 3*d*x
+            segments[i].a2 = subScoped( divScoped( segments[i].c, I(2.0Q) ),
+                                        mulScoped( I(3.0Q), mulScoped( segments[i].d, x[i] ) ) );
+            segments[i].a3 = segments[i].d;
+        }
+    }
+};
+
+// Obwiednia wartości segmentu dla xi (postać lokalna); wersja Scoped przy ustawionym FE_UPWARD
+static Interval intervalSegmentValueScoped(const IntervalSplineSegment &s, const Interval &xi) {
+    Interval dx = subScoped(xi, s.x);
+    Interval term1 = s.a;
+    Interval term2 = mulScoped(s.b, dx);
+    Interval term3 = mulScoped( divScoped( s.c, I(2.0Q) ), sqrScoped(dx) );
+    Interval term4 = mulScoped( s.d, cubeScoped(dx) );
+    return addScoped( addScoped(term1, term2), addScoped(term3, term4) );
+}
+
+static Interval intervalSegmentValue(const IntervalSplineSegment &s, const Interval &xi) {
+    fesetround(FE_UPWARD);
+    Interval r = intervalSegmentValueScoped(s, xi);
+    fesetround(FE_TONEAREST);
+    return r;
+}
+
+// Obwiednia pochodnej segmentu dla xi: b + c*dx + 3d*dx^2
+static Interval intervalSegmentSlopeScoped(const IntervalSplineSegment &s, const Interval &xi) {
+    Interval dx = subScoped(xi, s.x);
+    return addScoped( addScoped( s.b, mulScoped(s.c, dx) ),
+                      mulScoped( mulScoped( I(3.0Q), s.d ), sqrScoped(dx) ) );
+}
+
+// Obwiednia pierwiastka S(x) = level w arytmetyce przedziałowej trybów 2–3
+struct IntervalRoot {
+    Interval x;
+    bool unique = false;   // operator Newtona N(X) leży we wnętrzu X: w x jest dokładnie jeden
+                           // pierwiastek wielomianu segmentu dla każdego wyboru danych
+};
+
+// Przedziałowa metoda Newtona z bisekcją na dziedzinie domain segmentu s:
+// N(X) = m - (S(m) - level)/S'(X), X := X ∩ N(X). Części, na których obwiednia S - level nie
+// zawiera zera, są odrzucane; gdy S'(X) zawiera zero albo Newton przestaje zawężać, X jest
+// dzielony na pół. Obwiednie bez dowodu jednoznaczności zwracane są z unique = false, gdy
+// osiągną szerokość rzędu zaokrągleń albo – przy S'(X) zawierającym zero – gdy S(m) - level
+// zawiera zero, a X jest węższy niż sqrt(eps) względnie: wokół pierwiastka wielokrotnego
+// cała taka część jest numerycznie nierozróżnialna od pierwiastka.
+// Wszystkie obwiednie (S na X, S(m), S'(X) i N(X)) są zaokrąglane na zewnątrz w jednym
+// zakresie FE_UPWARD, więc odrzucona część na pewno nie zawiera pierwiastka, a unique jest
+// dowodem; punkt m = środek X nie musi być dokładny, wystarczy, że leży w X.
+static void intervalSegmentRoots(const IntervalSplineSegment &s, const Interval &domain,
+                                 const Interval &level, vector<IntervalRoot> &out) {
+    interval_arithmetic::RoundingScope<__float128> up(FE_UPWARD);
+    auto contains0 = [](const Interval &a) { return a.lo <= 0 && a.hi >= 0; };
+    auto small = [](const Interval &a) {
+        return a.hi - a.lo <= 64.0Q * FLT128_EPSILON * (fabsq(a.lo) + fabsq(a.hi)) + FLT128_MIN;
+    };
+    auto cluster = [&](const Interval &a) {
+        if (a.hi - a.lo > 1e-16Q * (fabsq(a.lo) + fabsq(a.hi)) + FLT128_MIN) return false;
+        __float128 m = a.lo / 2.0Q + a.hi / 2.0Q;
+        return contains0(subScoped(intervalSegmentValueScoped(s, I(m)), level));
+    };
+    vector<Interval> stack{domain};
+    for (int budget = 4096; !stack.empty() && budget > 0; budget--) {
+        Interval X = stack.back();
+        stack.pop_back();
+        if (!contains0(subScoped(intervalSegmentValueScoped(s, X), level)))
+            continue;
+        Interval slope = intervalSegmentSlopeScoped(s, X);
+        bool unique = false, empty = false;
+        if (!contains0(slope)) {
+            for (int it = 0; it < 64; it++) {
+                __float128 m = X.lo / 2.0Q + X.hi / 2.0Q;
+                Interval fm = subScoped(intervalSegmentValueScoped(s, I(m)), level);
+                Interval N = subScoped(I(m), divScoped(fm, slope));
+                if (N.lo > X.lo && N.hi < X.hi) unique = true;
+                Interval Y = {fmaxq(X.lo, N.lo), fminq(X.hi, N.hi)};
+                if (Y.lo > Y.hi) {
+                    empty = true;
+                    break;
+                }
+                // Koniec, gdy krok zawęża X o mniej niż 1/8
+                bool progress = Y.hi - Y.lo < (X.hi - X.lo) * 0.875Q;
+                X = Y;
+                if (!progress) break;
+                slope = intervalSegmentSlopeScoped(s, X);
+                if (contains0(slope)) break;
+            }
+            if (empty)
+                continue;
+            if (unique || small(X)) {
+                out.push_back({X, unique});
+                continue;
+            }
+        } else if (small(X) || cluster(X)) {
+            out.push_back({X, false});
+            continue;
+        }
+        __float128 m = X.lo / 2.0Q + X.hi / 2.0Q;
+        stack.push_back({m, X.hi});
+        stack.push_back({X.lo, m});
+    }
+    // Pozostałe po wyczerpaniu limitu części też mogą zawierać pierwiastki
+    for (const Interval &X : stack)
+        out.push_back({X, false});
+}
+
+// Wielomian środków współczynników segmentu (przybliżenie do szukania punktów krytycznych)
+static SplineSegment midpointSegment(const IntervalSplineSegment &s) {
+    auto mid = [](const Interval &a) { return a.lo / 2.0Q + a.hi / 2.0Q; };
+    SplineSegment m;
+    m.a = mid(s.a); m.b = mid(s.b); m.c = mid(s.c); m.d = mid(s.d); m.x = mid(s.x);
+    return m;
+}
+
+// Obwiednia wartości segmentu na X. Punkty krytyczne są zamykane w obwiedniach T_k tą samą
+// metodą co pierwiastki (intervalSegmentRoots dla S' = 0); poza nimi S' nie ma zera dla
+// żadnego wyboru danych, więc S jest monotoniczny i wystarczą wartości w końcach X i T_k.
+// Na T_k postać średniej S(m) + S'(T)(T - m) przeszacowuje o rząd S''*|T|^2 – dużo mniej
+// niż intervalSegmentValue(s, X) na całej dziedzinie. Całość liczona jest w jednym zakresie
+// FE_UPWARD z zaokrągleniem na zewnątrz, a obwiednie T_k są ścisłe (intervalSegmentRoots),
+// więc wynik obejmuje S na X dla każdego wyboru danych.
+static Interval intervalSegmentHull(const IntervalSplineSegment &s, const Interval &X) {
+    auto hull = [](const Interval &u, const Interval &v) {
+        return Interval{fminq(u.lo, v.lo), fmaxq(u.hi, v.hi)};
+    };
+    interval_arithmetic::RoundingScope<__float128> up(FE_UPWARD);
+    IntervalSplineSegment slope = s;
+    slope.a = s.b;
+    slope.b = s.c;
+    slope.c = mulScoped(I(6.0Q), s.d);
+    slope.d = I(0.0Q);
+    vector<IntervalRoot> crit;
+    intervalSegmentRoots(slope, X, I(0.0Q), crit);
+    Interval r = hull(intervalSegmentValueScoped(s, I(X.lo)),
+                      intervalSegmentValueScoped(s, I(X.hi)));
+    for (const IntervalRoot &t : crit) {
+        const Interval &T = t.x;
+        // Dowolny punkt T – środek zaokrąglony w górę nie wychodzi poza T.hi
+        __float128 m = T.lo / 2.0Q + T.hi / 2.0Q;
+        Interval c = addScoped(intervalSegmentValueScoped(s, I(m)),
+                               mulScoped(intervalSegmentSlopeScoped(s, T), subScoped(T, I(m))));
+        Interval d = intervalSegmentValueScoped(s, T);
+        r = hull(r, {fmaxq(c.lo, d.lo), fminq(c.hi, d.hi)});
+    }
+    return r;
+}
+
+// Zakres segmentu: domain – punkty, które mogą należeć do segmentu (przy przedziałowych
+// węzłach), certain – punkty, które na pewno do niego należą (pusty, gdy lo > hi).
+// min.lo i max.hi ograniczają S na domain, a max.lo i min.hi to obwiednie S w punktach
+// z certain: końcach i przybliżonych punktach krytycznych wielomianu środków (punkty
+// nie muszą być dokładne – każdy punkt z certain daje dolne ograniczenie maksimum i górne
+// minimum, a wartości w nich są obwiedniami zaokrąglanymi na zewnątrz).
+static SplineRange<Interval> intervalSegmentRange(const IntervalSplineSegment &s,
+                                                  const Interval &domain,
+                                                  const Interval &certain) {
+    Interval hull = intervalSegmentHull(s, domain);
+    SplineRange<Interval> r = {{hull.lo, HUGE_VALQ}, {-HUGE_VALQ, hull.hi}};
+    if (certain.lo > certain.hi)
+        return r;
+    SplineSegment m = midpointSegment(s);
+    __float128 pts[4] = {certain.lo, certain.hi}, crit[2];
+    int np = 2, nc = segmentCriticalPoints(m, certain.lo - m.x, certain.hi - m.x, crit);
+    for (int k = 0; k < nc; k++)
+        pts[np++] = fminq(fmaxq(m.x + crit[k], certain.lo), certain.hi);
+    for (int k = 0; k < np; k++) {
+        Interval v = intervalSegmentValue(s, I(pts[k]));
+        r.min.hi = fminq(r.min.hi, v.hi);
+        r.max.lo = fmaxq(r.max.lo, v.lo);
+    }
+    return r;
+}
+
+class NaturalCubicSplineInterval {
+private:
+    vector<Interval> x, y, h;
+    vector<IntervalSplineSegment> segments;
+    IntervalKnotIndex index;
+public:
+    // Konstruktor przyjmujący wektory przedziałów dla x i y. uniformGrid – wywołujący
+    // deklaruje, że prawdziwe węzły są równoodległe; bez deklaracji siatka jest uznawana
+    // za równomierną tylko dla węzłów punktowych o dokładnie równych odstępach.
+    NaturalCubicSplineInterval(const vector<Interval>& x_in, const vector<Interval>& y_in,
+                               bool uniformGrid = false)
+        : NaturalCubicSplineInterval(IntervalSplineFactor(x_in, uniformGrid), y_in) {
+    }
+
+    // Splajn z warunkami brzegowymi bc (domyślnie naturalnymi)
+    NaturalCubicSplineInterval(const vector<Interval>& x_in, const vector<Interval>& y_in,
+                               const SplineBoundary<Interval> &bc, bool uniformGrid = false)
+        : NaturalCubicSplineInterval(IntervalSplineFactor(x_in, bc, uniformGrid), y_in) {
+    }
+
+    // Splajn dla węzłów z gotowej faktoryzacji – liczona jest tylko część zależna od y
+    NaturalCubicSplineInterval(const IntervalSplineFactor &factor, const vector<Interval>& y_in) {
+        x = factor.x; y = y_in;
+        h = factor.h;
+        index = factor.index;
+        segments.resize(max((int) x.size() - 1, 0));
+        factor.fit(y.data(), segments.data());
+    }
+    
+    // Obliczenie S(xi) (postać lokalna) – xi jest przedziałem
+    tuple<Interval, Interval, Interval, Interval, Interval> evaluate(const Interval &xi) {
+        int n = segments.size();
+        if(n == 0) return {I(0.0Q), I(0.0Q), I(0.0Q), I(0.0Q), I(0.0Q)};
+        // Wybór segmentu analogicznie do trybu 1 – operujemy na dolnych i górnych granicach
+        int seg = index.segment(xi);
+        Interval value = valueAt(seg, xi);
+        return {value, segments[seg].a, segments[seg].b, divInt(segments[seg].c, I(2.0Q)), segments[seg].d};
+    }
+
+    // Obwiednia wartości segmentu seg dla xi (postać lokalna)
+    Interval valueAt(int seg, const Interval &xi) const {
+        return intervalSegmentValue(segments[seg], xi);
+    }
+
+    // Kursor dla rosnących zapytań (niemalejące xi.lo i xi.hi). Zamiast segmentu pamięta
+    // liczby lewych i prawych końców węzłów <= xi.lo, xi.hi – obie tylko rosną, a wybór
+    // segmentu z IntervalKnotIndex::segmentFromCounts daje ten sam wynik co evaluate.
+    class Cursor {
+    private:
+        const NaturalCubicSplineInterval *spline;
+        long ubLo = 0, ubHi = 0;
+
+        long advance(long count, __float128 q, __float128 Interval::*end) const {
+            const vector<Interval> &x = spline->x;
+            long n = (long) x.size();
+            bool back = count > 0 && !(x[count - 1].*end <= q);
+            for (int step = 0; !back && count < n && x[count].*end <= q; step++) {
+                if (step == 8) {
+                    back = true;
+                    break;
+                }
+                count++;
+            }
+            if (back)
+                count = upper_bound(x.begin(), x.end(), q, [end](__float128 v, const Interval &e) {
+                    return v < e.*end;
+                }) - x.begin();
+            return count;
+        }
+
+    public:
+        explicit Cursor(const NaturalCubicSplineInterval &s) : spline(&s) {
+        }
+
+        int segment(const Interval &xi) {
+            ubLo = advance(ubLo, xi.lo, &Interval::lo);
+            ubHi = advance(ubHi, xi.hi, &Interval::hi);
+            return spline->index.segmentFromCounts(xi, ubLo, ubHi);
+        }
+
+        Interval value(const Interval &xi) {
+            if (spline->segments.empty()) return I(0.0Q);
+            return spline->valueAt(segment(xi), xi);
+        }
+    };
+
+    Cursor cursor() const {
+        return Cursor(*this);
+    }
+
+    // Obwiednie S(x0 + k*dx) dla k = 0..count-1 zapisane kolejno do out. Punkt siatki to
+    // przedział [x0 + k*dx zaokrąglone w dół, x0 + k*dx zaokrąglone w górę] (k jest dokładne
+    // w float128), więc obejmuje dokładną wartość; wszystkie punkty powstają w jednym
+    // przebiegu FE_UPWARD, dolne końce jako -(górna granica wartości przeciwnej).
+    void resample(__float128 x0, __float128 dx, size_t count, Interval *out) const {
+        using interval_arithmetic::AddDown;
+        using interval_arithmetic::MulDown;
+        fesetround(FE_UPWARD);
+        for (size_t k = 0; k < count; k++) {
+            __float128 kq = (__float128) k;
+            out[k].lo = AddDown(x0, MulDown(kq, dx));
+            out[k].hi = x0 + kq * dx;
+        }
+        fesetround(FE_TONEAREST);
+        Cursor cur(*this);
+        for (size_t k = 0; k < count; k++)
+            out[k] = cur.value(out[k]);
+    }
+
+    // Obwiednie wszystkich pierwiastków S(x) = level w [x[0].lo, x[n-1].hi], rosnąco.
+    // Segment i jest przeszukiwany na [x[i].lo, x[i+1].hi]; nakładające się obwiednie
+    // (z sąsiednich segmentów albo bisekcji) są łączone i tracą znacznik unique.
+    vector<IntervalRoot> roots(const Interval &level) const {
+        return roots(vector<Interval>{level})[0];
+    }
+
+    // Wiele poziomów: obwiednia wartości każdego segmentu na jego dziedzinie liczona raz,
+    // segmenty, których obwiednia nie przecina poziomu, są pomijane
+    vector<vector<IntervalRoot>> roots(const vector<Interval> &levels) const {
+        vector<vector<IntervalRoot>> out(levels.size());
+        int count = segments.size();
+        for (int i = 0; i < count; i++) {
+            Interval domain = {x[i].lo, x[i+1].hi};
+            Interval range = intervalSegmentValue(segments[i], domain);
+            for (size_t k = 0; k < levels.size(); k++)
+                if (levels[k].lo <= range.hi && levels[k].hi >= range.lo)
+                    intervalSegmentRoots(segments[i], domain, levels[k], out[k]);
+        }
+        for (auto &list : out) {
+            sort(list.begin(), list.end(), [](const IntervalRoot &a, const IntervalRoot &b) {
+                return a.x.lo < b.x.lo;
+            });
+            vector<IntervalRoot> merged;
+            for (const IntervalRoot &r : list) {
+                if (!merged.empty() && r.x.lo <= merged.back().x.hi) {
+                    merged.back().x.hi = fmaxq(merged.back().x.hi, r.x.hi);
+                    merged.back().unique = false;
+                } else {
+                    merged.push_back(r);
+                }
+            }
+            list.swap(merged);
+        }
+        return out;
+    }
+
+    // Zapytania o obwiednie minimum i maksimum S na [a, b] (jak NaturalCubicSpline::Extrema).
+    // Segment i może obejmować punkty z [x[i].lo, x[i+1].hi], a na pewno obejmuje
+    // [x[i].hi, x[i+1].lo] (skrajne segmenty także ekstrapolację). Z tablicy brane są
+    // segmenty, których oba te zbiory leżą w [a, b]; pozostałe przecinające [a, b] (zwykle
+    // po jednym z każdej strony) liczone są z dziedziną przyciętą do [a, b].
+    class Extrema {
+    private:
+        const NaturalCubicSplineInterval *spline;
+        RangeTable<Interval> table;
+
+        SplineRange<Interval> segmentRange(int i, __float128 a, __float128 b) const {
+            const vector<Interval> &x = spline->x;
+            int last = (int) spline->segments.size() - 1;
+            Interval domain = {i == 0 ? a : fmaxq(a, x[i].lo),
+                               i == last ? b : fminq(b, x[i + 1].hi)};
+            Interval certain = {i == 0 ? a : fmaxq(a, x[i].hi),
+                                i == last ? b : fminq(b, x[i + 1].lo)};
+            return intervalSegmentRange(spline->segments[i], domain, certain);
+        }
+
+    public:
+        explicit Extrema(const NaturalCubicSplineInterval &s) : spline(&s) {
+            const vector<Interval> &x = s.x;
+            vector<SplineRange<Interval>> r(s.segments.size());
+            for (size_t i = 0; i < r.size(); i++)
+                r[i] = intervalSegmentRange(s.segments[i], {x[i].lo, x[i + 1].hi},
+                                            {x[i].hi, x[i + 1].lo});
+            table = RangeTable<Interval>(std::move(r));
+        }
+
+        SplineRange<Interval> range(__float128 a, __float128 b) const {
+            const vector<Interval> &x = spline->x;
+            int count = spline->segments.size();
+            if (count == 0) return {I(0.0Q), I(0.0Q)};
+            if (b < a) swap(a, b);
+            // Przecinające [a, b]: i = first..end; pełne: i = full..fullEnd (bez skrajnych)
+            auto knots = x.begin() + 1, knotsEnd = x.begin() + count;
+            int first = partition_point(knots, knotsEnd,
+                                        [&](const Interval &v) { return v.hi < a; }) - knots;
+            int end = partition_point(knots, knotsEnd,
+                                      [&](const Interval &v) { return v.lo <= b; }) - knots;
+            int full = max(1, (int) (partition_point(knots, knotsEnd,
+                                     [&](const Interval &v) { return v.lo < a; }) - knots) + 1);
+            int fullEnd = min(count - 2, (int) (partition_point(knots, knotsEnd,
+                                     [&](const Interval &v) { return v.hi <= b; }) - knots) - 1);
+            if (full > fullEnd) {
+                full = end + 1;
+                fullEnd = end;
+            }
+            SplineRange<Interval> out = {{HUGE_VALQ, HUGE_VALQ}, {-HUGE_VALQ, -HUGE_VALQ}};
+            for (int i = first; i <= end; i++) {
+                if (i == full) {
+                    out = joinRange(out, table.query(full, fullEnd));
+                    i = fullEnd;
+                    continue;
+                }
+                out = joinRange(out, segmentRange(i, a, b));
+            }
+            return out;
+        }
+    };
+
+    Extrema extrema() const {
+        return Extrema(*this);
+    }
+
+    const vector<IntervalSplineSegment>& getSegments() const {
+        return segments;
+    }
+
+    // Wypisanie współczynników globalnych – przedziały wypisywane w formacie "[lo, hi]"
+    void printCoefficients(ofstream &outputFile) {
+        printIntervalCoefficients(segments, outputFile);
+    }
+};
+
+// Wiele splajnów przedziałowych o tych samych węzłach: zbiór j ma wartości
+// ys[j*n .. (j+1)*n-1], a jego n - 1 segmentów leży we wspólnym buforze od pozycji j*(n-1).
+// Faktoryzacja i indeks węzłów są wspólne, zbiory dopasowywane są równolegle
+// (threads = 0 – tyle wątków, ile rdzeni).
+class IntervalSplineBatch {
+private:
+    IntervalSplineFactor factor;
+    size_t count = 0, stride = 0;
+    vector<IntervalSplineSegment> segments;
+public:
+    IntervalSplineBatch(const IntervalSplineFactor &f, const vector<Interval> &ys,
+                        unsigned threads = 0) : factor(f) {
+        size_t n = factor.size();
+        if (n < 2 || ys.size() % n != 0)
+            throw std::invalid_argument("Liczba wartości y nie jest wielokrotnością liczby węzłów");
+        count = ys.size() / n;
+        stride = n - 1;
+        segments.resize(count * stride);
+        // fit zgłasza wyjątek np. dla rozłącznych y[0] i y[n-1] przy warunku okresowym –
+        // parallelRanges przekazuje go wywołującemu
+        parallelRanges(count, threads, 1, [&](size_t first, size_t last) {
+            for (size_t j = first; j < last; j++)
+                factor.fit(ys.data() + j * n, segments.data() + j * stride);
+        });
+    }
+
+    // Liczba zbiorów danych
+    size_t size() const {
+        return count;
+    }
+
+    const IntervalSplineSegment *segmentsOf(size_t j) const {
+        return segments.data() + j * stride;
+    }
+
+    // Obwiednia S_j(xi) – segment jak w NaturalCubicSplineInterval::evaluate
+    Interval evaluate(size_t j, const Interval &xi) const {
+        return intervalSegmentValue(segmentsOf(j)[factor.index.segment(xi)], xi);
+    }
+};
+
+// ====================
+// Splajn dwuwymiarowy (tryby 8–10)
+// ====================
+// Naturalny splajn bikubiczny na siatce x[0..nx-1] × y[0..ny-1] jako iloczyn tensorowy:
+// najpierw splajny wzdłuż y dla każdego wiersza x[i], potem splajny wzdłuż x dla każdego
+// współczynnika każdego segmentu y. Dopasowanie jest liniowe w danych, więc wynik nie
+// zależy od kolejności osi. Komórka (i, l) przechowuje 16 współczynników
+// S(x, y) = sum C[p][q] * (x - x[i])^p * (y - y[l])^q, liczonych raz przy konstrukcji.
+
+class NaturalBicubicSpline {
+private:
+    vector<__float128> x, y;
+    KnotIndex indexX, indexY;
+    vector<array<__float128, 16>> cells; // cells[i*(ny-1) + l][4*p + q]
+
+public:
+    // z[i*ny + j] = f(x[i], y[j]); wiersze i kolumny dopasowywane równolegle
+    NaturalBicubicSpline(const vector<__float128>& x_in, const vector<__float128>& y_in,
+                         const vector<__float128>& z, unsigned threads = 0) {
+        x = x_in; y = y_in;
+        size_t nx = x.size(), ny = y.size();
+        if (nx < 2 || ny < 2 || z.size() != nx * ny)
+            throw std::invalid_argument("Siatka splajnu dwuwymiarowego musi mieć co najmniej 2×2 węzły i nx*ny wartości");
+        indexX.build(x);
+        indexY.build(y);
+        size_t sy = ny - 1, sx = nx - 1;
+        vector<SplineSegment> rows(nx * sy);
+        SplineBoundary<__float128> natural;
+        parallelRanges(nx, threads, 64, [&](size_t first, size_t last) {
+            SplineWorkspace ws;
+            for (size_t i = first; i < last; i++)
+                fitCubicSpline(y.data(), z.data() + i * ny, (int) ny, natural, false, ws,
+                               rows.data() + i * sy);
+        });
+        cells.resize(sx * sy);
+        parallelRanges(sy, threads, 16, [&](size_t first, size_t last) {
+            SplineWorkspace ws;
+            vector<__float128> column(nx);
+            vector<SplineSegment> seg(sx);
+            for (size_t l = first; l < last; l++)
+                for (int q = 0; q < 4; q++) {
+                    for (size_t i = 0; i < nx; i++) {
+                        const SplineSegment &r = rows[i * sy + l];
+                        column[i] = q == 0 ? r.a : q == 1 ? r.b : q == 2 ? r.c / 2.0Q : r.d;
+                    }
+                    fitCubicSpline(x.data(), column.data(), (int) nx, natural, false, ws,
+                                   seg.data());
+                    for (size_t i = 0; i < sx; i++) {
+                        array<__float128, 16> &cell = cells[i * sy + l];
+                        cell[q] = seg[i].a;
+                        cell[4 + q] = seg[i].b;
+                        cell[8 + q] = seg[i].c / 2.0Q;
+                        cell[12 + q] = seg[i].d;
+                    }
+                }
+        });
+    }
+
+    // S(xi, yi) – komórka według reguły NaturalCubicSpline::evaluate w każdej osi
+    __float128 evaluate(__float128 xi, __float128 yi) const {
+        int i = indexX.segment(xi), l = indexY.segment(yi);
+        const array<__float128, 16> &C = cells[i * (y.size() - 1) + l];
+        __float128 dx = xi - x[i], dy = yi - y[l], value = 0.0Q;
+        for (int p = 3; p >= 0; p--) {
+            const __float128 *r = C.data() + 4 * p;
+            value = value * dx + (((r[3] * dy + r[2]) * dy + r[1]) * dy + r[0]);
+        }
+        return value;
+    }
+
+    // out[k] = S(xs[k], ys[k]) dla rozproszonych punktów, równolegle
+    void evaluate(const __float128 *xs, const __float128 *ys, size_t count, __float128 *out,
+                  unsigned threads = 0) const {
+        parallelRanges(count, threads, 4096, [&](size_t first, size_t last) {
+            for (size_t k = first; k < last; k++)
+                out[k] = evaluate(xs[k], ys[k]);
+        });
+    }
+
+    // Współczynniki komórki (i, l): [4*p + q] przy (x - x[i])^p * (y - y[l])^q
+    const array<__float128, 16> &cell(size_t i, size_t l) const {
+        return cells[i * (y.size() - 1) + l];
+    }
+};
+
+// Wersja przedziałowa: te same dwa przebiegi na IntervalSplineFactor (faktoryzacja węzłów
+// każdej osi liczona raz, wiersze i kolumny dopasowywane przez fit)
+class NaturalBicubicSplineInterval {
+private:
+    vector<Interval> x, y;
+    IntervalKnotIndex indexX, indexY;
+    vector<array<Interval, 16>> cells;   // cells[i*(ny-1) + l][4*p + q]
+
+public:
+    NaturalBicubicSplineInterval(const vector<Interval>& x_in, const vector<Interval>& y_in,
+                                 const vector<Interval>& z, unsigned threads = 0) {
+        x = x_in; y = y_in;
+        size_t nx = x.size(), ny = y.size();
+        if (nx < 2 || ny < 2 || z.size() != nx * ny)
+            throw std::invalid_argument("Siatka splajnu dwuwymiarowego musi mieć co najmniej 2×2 węzły i nx*ny wartości");
+        indexX.build(x);
+        indexY.build(y);
+        IntervalSplineFactor factorX(x), factorY(y);
+        size_t sy = ny - 1, sx = nx - 1;
+        vector<IntervalSplineSegment> rows(nx * sy);
+        parallelRanges(nx, threads, 16, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++)
+                factorY.fit(z.data() + i * ny, rows.data() + i * sy);
+        });
+        cells.resize(sx * sy);
+        parallelRanges(sy, threads, 4, [&](size_t first, size_t last) {
+            vector<Interval> column(nx);
+            vector<IntervalSplineSegment> seg(sx);
+            for (size_t l = first; l < last; l++)
+                for (int q = 0; q < 4; q++) {
+                    for (size_t i = 0; i < nx; i++) {
+                        const IntervalSplineSegment &r = rows[i * sy + l];
+                        column[i] = q == 0 ? r.a : q == 1 ? r.b : q == 2 ? divInt(r.c, I(2.0Q)) : r.d;
+                    }
+                    factorX.fit(column.data(), seg.data());
+                    for (size_t i = 0; i < sx; i++) {
+                        array<Interval, 16> &cell = cells[i * sy + l];
+                        cell[q] = seg[i].a;
+                        cell[4 + q] = seg[i].b;
+                        cell[8 + q] = divInt(seg[i].c, I(2.0Q));
+                        cell[12 + q] = seg[i].d;
+                    }
+                }
+        });
+    }
+
+    // Obwiednia S(xi, yi); potęgi przyrostów liczone przez sqr i pown jak w
+    // intervalSegmentValue
+    Interval evaluate(const Interval &xi, const Interval &yi) const {
+        int i = indexX.segment(xi), l = indexY.segment(yi);
+        const array<Interval, 16> &C = cells[i * (y.size() - 1) + l];
+        Interval dx = subInt(xi, x[i]), dy = subInt(yi, y[l]);
+        Interval px[4] = {I(1.0Q), dx, sqr(dx), pown(dx, 3)};
+        Interval py[4] = {I(1.0Q), dy, sqr(dy), pown(dy, 3)};
+        Interval value = I(0.0Q);
+        for (int p = 0; p < 4; p++) {
+            Interval row = C[4 * p];
+            for (int q = 1; q < 4; q++)
+                row = add( row, mul( C[4 * p + q], py[q] ) );
+            value = add( value, p == 0 ? row : mul( row, px[p] ) );
+        }
+        return value;
+    }
+
+    void evaluate(const Interval *xs, const Interval *ys, size_t count, Interval *out,
+                  unsigned threads = 0) const {
+        parallelRanges(count, threads, 1024, [&](size_t first, size_t last) {
+            for (size_t k = first; k < last; k++)
+                out[k] = evaluate(xs[k], ys[k]);
+        });
+    }
+
+    const array<Interval, 16> &cell(size_t i, size_t l) const {
+        return cells[i * (y.size() - 1) + l];
+    }
+};
+
+// ====================
+// Dla trybu 4 (arytmetyka afiniczna)
+// ====================
+// Forma afiniczna: x = x0 + sum(x_k * eps_k) + [-err, err], gdzie eps_k należą do [-1, 1].
+// Wspólne symbole szumu eps_k zachowują korelacje między wielkościami (np. x[i] występuje
+// w h[i-1] i h[i]), których zwykła arytmetyka przedziałowa nie widzi, więc obwiednie
+// współczynników i S(xx) są węższe niż w trybie 3.
+struct AffineForm {
+    __float128 center;
+    vector<pair<int, __float128>> terms; // (numer symbolu, współczynnik), posortowane po symbolu
+    __float128 err;                      // nieujemny składnik niezależny (zaokrąglenia, linearyzacja)
+    // Maksymalna liczba symboli w formie – najmniejsze nadmiarowe trafiają do err,
+    // dzięki czemu koszt operacji jest O(maxTerms), a nie O(n)
+    static inline size_t maxTerms = 12;
+};
+
+// Stała jako forma afiniczna
+AffineForm AF(__float128 v) {
+    AffineForm r; r.center = v; r.err = 0.0Q; return r;
+}
+
+// Przedział wejściowy jako forma afiniczna z własnym symbolem szumu
+AffineForm affFromInterval(const Interval &x, int symbol) {
+    AffineForm r;
+    r.center = x.lo / 2.0Q + x.hi / 2.0Q;
+    fesetround(FE_UPWARD);
+    __float128 rad = fmaxq(x.hi - r.center, r.center - x.lo);
+    fesetround(FE_TONEAREST);
+    r.err = 0.0Q;
+    if (rad > 0) r.terms.push_back({symbol, rad});
+    return r;
+}
+
+// Promień formy (zaokrąglony w górę); wywołujący ustawia FE_UPWARD
+static inline __float128 affRadiusUp(const AffineForm &x) {
+    __float128 rad = x.err;
+    for (const auto &t : x.terms) rad += fabsq(t.second);
+    return rad;
+}
+
+// Obwiednia przedziałowa formy afinicznej
+Interval toInterval(const AffineForm &x) {
+    Interval r;
+    fesetround(FE_UPWARD);
+    __float128 rad = affRadiusUp(x);
+    r.hi = x.center + rad;
+    fesetround(FE_DOWNWARD);
+    r.lo = x.center - rad;
+    fesetround(FE_TONEAREST);
+    return r;
+}
+
+// Przeniesienie najmniejszych współczynników do err, gdy symboli jest za dużo
+static void affCondense(AffineForm &x) {
+    if (x.terms.size() <= AffineForm::maxTerms) return;
+    vector<__float128> mags(x.terms.size());
+    for (size_t k = 0; k < x.terms.size(); k++) mags[k] = fabsq(x.terms[k].second);
+    size_t drop = x.terms.size() - AffineForm::maxTerms;
+    nth_element(mags.begin(), mags.begin() + (drop - 1), mags.end());
+    __float128 threshold = mags[drop - 1];
+    size_t out = 0;
+    fesetround(FE_UPWARD);
+    for (size_t k = 0; k < x.terms.size(); k++) {
+        if (drop > 0 && fabsq(x.terms[k].second) <= threshold) {
+            x.err += fabsq(x.terms[k].second);
+            drop--;
+        } else {
+            x.terms[out++] = x.terms[k];
+        }
+    }
+    fesetround(FE_TONEAREST);
+    x.terms.resize(out);
+}
+
+// z = alpha*x + beta*y + gamma ± delta.
+// Współczynniki liczone są w zaokrągleniu do najbliższej, a ograniczenie ich błędu
+// (2*eps na każdy współczynnik) jest doliczane do err w zaokrągleniu w górę.
+static AffineForm affLinear(const AffineForm &x, __float128 alpha, const AffineForm &y,
+                            __float128 beta, __float128 gamma, __float128 delta) {
+    AffineForm r;
+    r.center = alpha * x.center + beta * y.center + gamma;
+    r.terms.reserve(x.terms.size() + y.terms.size());
+    size_t i = 0, j = 0;
+    while (i < x.terms.size() || j < y.terms.size()) {
+        if (j == y.terms.size() || (i < x.terms.size() && x.terms[i].first < y.terms[j].first)) {
+            r.terms.push_back({x.terms[i].first, alpha * x.terms[i].second}); i++;
+        } else if (i == x.terms.size() || y.terms[j].first < x.terms[i].first) {
+            r.terms.push_back({y.terms[j].first, beta * y.terms[j].second}); j++;
+        } else {
+            r.terms.push_back({x.terms[i].first, alpha * x.terms[i].second + beta * y.terms[j].second});
+            i++; j++;
+        }
+    }
+    fesetround(FE_UPWARD);
+    __float128 acc = fabsq(alpha * x.center) + fabsq(beta * y.center) + fabsq(gamma);
+    for (const auto &t : x.terms) acc += fabsq(alpha * t.second);
+    for (const auto &t : y.terms) acc += fabsq(beta * t.second);
+    r.err = fabsq(alpha) * x.err + fabsq(beta) * y.err + delta
+          + 2.0Q * FLT128_EPSILON * acc + (r.terms.size() + 1) * FLT128_MIN;
+    fesetround(FE_TONEAREST);
+    affCondense(r);
+    return r;
+}
+
+AffineForm add(const AffineForm &a, const AffineForm &b) {
+    return affLinear(a, 1.0Q, b, 1.0Q, 0.0Q, 0.0Q);
+}
+
+AffineForm subInt(const AffineForm &a, const AffineForm &b) {
+    return affLinear(a, 1.0Q, b, -1.0Q, 0.0Q, 0.0Q);
+}
+
+AffineForm mul(const AffineForm &a, const AffineForm &b) {
+    AffineForm r;
+    r.center = a.center * b.center;
+    r.terms.reserve(a.terms.size() + b.terms.size());
+    size_t i = 0, j = 0;
+    while (i < a.terms.size() || j < b.terms.size()) {
+        if (j == b.terms.size() || (i < a.terms.size() && a.terms[i].first < b.terms[j].first)) {
+            r.terms.push_back({a.terms[i].first, b.center * a.terms[i].second}); i++;
+        } else if (i == a.terms.size() || b.terms[j].first < a.terms[i].first) {
+            r.terms.push_back({b.terms[j].first, a.center * b.terms[j].second}); j++;
+        } else {
+            r.terms.push_back({a.terms[i].first,
+                               b.center * a.terms[i].second + a.center * b.terms[j].second});
+            i++; j++;
+        }
+    }
+    fesetround(FE_UPWARD);
+    __float128 acc = fabsq(a.center * b.center);
+    for (const auto &t : a.terms) acc += fabsq(b.center * t.second);
+    for (const auto &t : b.terms) acc += fabsq(a.center * t.second);
+    // Składnik nieliniowy szacujemy iloczynem promieni
+    r.err = fabsq(a.center) * b.err + fabsq(b.center) * a.err + affRadiusUp(a) * affRadiusUp(b)
+          + 2.0Q * FLT128_EPSILON * acc + (r.terms.size() + 1) * FLT128_MIN;
+    fesetround(FE_TONEAREST);
+    affCondense(r);
+    return r;
+}
+
+// Odwrotność metodą minimalnego zakresu: 1/y ≈ alpha*y + zeta ± delta na [lo, hi]
+static AffineForm affInverse(const AffineForm &y) {
+    Interval range = toInterval(y);
+    if (range.lo <= 0 && range.hi >= 0) {
+        throw std::invalid_argument("Dzielenie przez przedział zawierający zero");
+    }
+    bool negative = range.hi < 0;
+    __float128 lo = negative ? -range.hi : range.lo;
+    __float128 hi = negative ? -range.lo : range.hi;
+    // |alpha| <= 1/hi^2 gwarantuje, że 1/t - alpha*t maleje na [lo, hi]
+    fesetround(FE_UPWARD);
+    __float128 hi2 = hi * hi;
+    fesetround(FE_DOWNWARD);
+    __float128 slope = 1.0Q / hi2;
+    __float128 gHi = 1.0Q / hi + slope * hi;
+    fesetround(FE_UPWARD);
+    __float128 gLo = 1.0Q / lo + slope * lo;
+    fesetround(FE_TONEAREST);
+    __float128 zeta = gLo / 2.0Q + gHi / 2.0Q;
+    fesetround(FE_UPWARD);
+    __float128 delta = fmaxq(gLo - zeta, zeta - gHi);
+    fesetround(FE_TONEAREST);
+    // Dla y < 0: 1/y = -(1/(-y)) = -slope*y - zeta, nachylenie jest takie samo
+    return affLinear(y, -slope, AF(0.0Q), 0.0Q, negative ? -zeta : zeta, delta);
+}
+
+AffineForm divInt(const AffineForm &a, const AffineForm &b) {
+    if (b.terms.empty() && b.err == 0) {
+        // Dzielenie przez stałą – bez linearyzacji, błąd odwrotności trafia do err
+        if (b.center == 0) throw std::invalid_argument("Dzielenie przez przedział zawierający zero");
+        AffineForm inv = AF(1.0Q / b.center);
+        fesetround(FE_UPWARD);
+        inv.err = fabsq(inv.center) * FLT128_EPSILON + FLT128_MIN;
+        fesetround(FE_TONEAREST);
+        return mul(a, inv);
+    }
+    return mul(a, affInverse(b));
+}
+
+struct AffineSplineSegment {
+    AffineForm a, b, c, d; // współczynniki lokalne
+    AffineForm x;          // początek przedziału
+};
+
+class NaturalCubicSplineAffine {
+private:
+    vector<Interval> x;
+    vector<AffineForm> xa, ya, h;
+    vector<AffineSplineSegment> localSegments;
+    vector<IntervalSplineSegment> segments;
+    IntervalKnotIndex index;
+public:
+    // Konstruktor przyjmujący wektory przedziałów dla x i y; x[i] dostaje symbol i, y[i] symbol n+i
+    NaturalCubicSplineAffine(const vector<Interval>& x_in, const vector<Interval>& y_in) {
+        x = x_in;
+        index.build(x);
+        int n = x.size();
+        xa.resize(n); ya.resize(n);
+        for (int i = 0; i < n; i++) {
+            xa[i] = affFromInterval(x_in[i], i);
+            ya[i] = affFromInterval(y_in[i], n + i);
+        }
+        h.resize(n - 1);
+        for (int i = 0; i < n - 1; i++) {
+            h[i] = subInt(xa[i+1], xa[i]);
+            Interval hi = toInterval(h[i]);
+            if (hi.lo <= 0 && hi.hi >= 0) {
+                throw std::invalid_argument("Przedział h[i] zawiera zero, co uniemożliwia konstrukcję splajnu");
+            }
+        }
+        // Ten sam układ co w NaturalCubicSplineInterval, ale na formach afinicznych
+        vector<AffineForm> alpha(n, AF(0.0Q)), l(n, AF(0.0Q)), mu(n, AF(0.0Q)), z(n, AF(0.0Q));
+        l[0] = AF(1.0Q);
+        for (int i = 1; i < n - 1; i++) {
+            AffineForm diff1 = divInt( subInt(ya[i+1], ya[i]), h[i] );
+            AffineForm diff2 = divInt( subInt(ya[i], ya[i-1]), h[i-1] );
+            alpha[i] = mul( AF(6.0Q), subInt(diff1, diff2) );
+            l[i] = subInt( mul(AF(2.0Q), subInt(xa[i+1], xa[i-1]) ), mul( h[i-1], mu[i-1] ) );
+            mu[i] = divInt( h[i], l[i] );
+            z[i] = divInt( subInt(alpha[i], mul( h[i-1], z[i-1] ) ), l[i] );
+        }
+        l[n - 1] = AF(1.0Q);
+        vector<AffineForm> c(n, AF(0.0Q)), b(n - 1, AF(0.0Q)), d(n - 1, AF(0.0Q));
+        for (int j = n - 2; j >= 0; j--) {
+            c[j] = subInt(z[j], mul( mu[j], c[j+1] ) );
+            AffineForm term = add( c[j+1], mul( AF(2.0Q), c[j] ) );
+            b[j] = subInt( divInt( subInt(ya[j+1], ya[j]), h[j] ),
+                           divInt( mul( h[j], term ), AF(6.0Q) ) );
+            d[j] = divInt( subInt(c[j+1], c[j]), mul( AF(6.0Q), h[j] ) );
+        }
+        localSegments.resize(n - 1);
+        segments.resize(n - 1);
+        for (int i = 0; i < n - 1; i++) {
+            AffineSplineSegment &s = localSegments[i];
+            s.a = ya[i]; s.b = b[i]; s.c = c[i]; s.d = d[i]; s.x = xa[i];
+            // Postać globalna liczona afinicznie – x[i] występuje we wszystkich składnikach
+            // z tym samym symbolem, więc znoszenie się składników jest zachowane
+            AffineForm x2 = mul(xa[i], xa[i]);
+            AffineForm x3 = mul(x2, xa[i]);
+            AffineForm a0 = subInt( add( subInt( s.a, mul( s.b, xa[i] ) ),
+                                         divInt( mul( s.c, x2 ), AF(2.0Q) ) ),
+                                    mul( s.d, x3 ) );
+            AffineForm a1 = add( subInt( s.b, mul( s.c, xa[i] ) ), mul( AF(3.0Q), mul( s.d, x2 ) ) );
+            AffineForm a2 = subInt( divInt( s.c, AF(2.0Q) ), mul( AF(3.0Q), mul( s.d, xa[i] ) ) );
+            segments[i].a = toInterval(s.a);
+            segments[i].b = toInterval(s.b);
+            segments[i].c = toInterval(s.c);
+            segments[i].d = toInterval(s.d);
+            segments[i].x = x[i];
+            segments[i].a0 = toInterval(a0);
+            segments[i].a1 = toInterval(a1);
+            segments[i].a2 = toInterval(a2);
+            segments[i].a3 = segments[i].d;
+        }
+    }
+
+    // Obliczenie S(xi) schematem Hornera; xi dostaje nowy symbol 2n
+    tuple<Interval, Interval, Interval, Interval, Interval> evaluate(const Interval &xi) {
+        int n = segments.size();
+        if(n == 0) return {I(0.0Q), I(0.0Q), I(0.0Q), I(0.0Q), I(0.0Q)};
+        int seg = index.segment(xi);
+        const AffineSplineSegment &s = localSegments[seg];
+        AffineForm dx = subInt(affFromInterval(xi, 2 * (int) x.size()), s.x);
+        AffineForm c2 = divInt(s.c, AF(2.0Q));
+        AffineForm value = add( s.a, mul( dx, add( s.b, mul( dx, add( c2, mul( dx, s.d ) ) ) ) ) );
+        return {toInterval(value), segments[seg].a, segments[seg].b, toInterval(c2), segments[seg].d};
+    }
+
+    void printCoefficients(ofstream &outputFile) {
+        printIntervalCoefficients(segments, outputFile);
+    }
+};
+
 // ====================
-// Dla trybu 2 i 3 (arytmetyka przedziałowa)
+// Postać środek-promień (MidRadInterval<double> z interval.h)
 // ====================
+// Środek i promień w sprzętowym double; cała konstrukcja splajnu idzie w jednym trybie
+// FE_UPWARD (zob. MRAdd/MRMul w interval.h), bez zmian trybu przy każdym działaniu.
+typedef interval_arithmetic::MidRadInterval<double> MidRad;
 
-// Konstruktor przedziału ze skalara (obustronnie taki sam)
-Interval I(__float128 v) {
-    Interval r; r.lo = v; r.hi = v; return r;
+// Zamiana przedziału __float128 na <mid, rad> w double – promień zaokrąglony w górę
+// obejmuje również błąd zaokrąglenia środka do double
+MidRad toMidRad(const Interval &x) {
+    MidRad r;
+    r.mid = (double) (x.lo / 2.0Q + x.hi / 2.0Q);
+    fesetround(FE_UPWARD);
+    r.rad = (double) fmaxq(x.hi - r.mid, r.mid - x.lo);
+    fesetround(FE_TONEAREST);
+    return r;
 }
 
-Interval add(const Interval &a, const Interval &b) {
+Interval fromMidRad(const MidRad &x) {
     Interval r;
-    r.lo = a.lo + b.lo;
-    r.hi = a.hi + b.hi;
+    fesetround(FE_DOWNWARD);
+    r.lo = (__float128) x.mid - x.rad;
+    fesetround(FE_UPWARD);
+    r.hi = (__float128) x.mid + x.rad;
+    fesetround(FE_TONEAREST);
     return r;
 }
 
-Interval subInt(const Interval &a, const Interval &b) {
-    // odejmowanie: [a.lo - b.hi, a.hi - b.lo]
-    Interval r;
-    r.lo = a.lo - b.hi;
-    r.hi = a.hi - b.lo;
-    return r;
+// Wersje wsadowe – jeden przebieg na kierunek zaokrąglenia (jak sqrBatch)
+void toMidRadBatch(const Interval *in, MidRad *out, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        out[i].mid = (double) (in[i].lo / 2.0Q + in[i].hi / 2.0Q);
+    fesetround(FE_UPWARD);
+    for (size_t i = 0; i < count; i++)
+        out[i].rad = (double) fmaxq(in[i].hi - out[i].mid, out[i].mid - in[i].lo);
+    fesetround(FE_TONEAREST);
 }
 
-Interval mul(const Interval &a, const Interval &b) {
-    __float128 p1 = a.lo * b.lo;
-    __float128 p2 = a.lo * b.hi;
-    __float128 p3 = a.hi * b.lo;
-    __float128 p4 = a.hi * b.hi;
-    Interval r;
-    r.lo = p1;
-    if (p2 < r.lo) r.lo = p2;
-    if (p3 < r.lo) r.lo = p3;
-    if (p4 < r.lo) r.lo = p4;
-    r.hi = p1;
-    if (p2 > r.hi) r.hi = p2;
-    if (p3 > r.hi) r.hi = p3;
-    if (p4 > r.hi) r.hi = p4;
-    return r;
+void fromMidRadBatch(const MidRad *in, Interval *out, size_t count) {
+    fesetround(FE_DOWNWARD);
+    for (size_t i = 0; i < count; i++)
+        out[i].lo = (__float128) in[i].mid - in[i].rad;
+    fesetround(FE_UPWARD);
+    for (size_t i = 0; i < count; i++)
+        out[i].hi = (__float128) in[i].mid + in[i].rad;
+    fesetround(FE_TONEAREST);
 }
 
-Interval divInt(const Interval &a, const Interval &b) {
-    // Sprawdzamy, czy przedział b zawiera zero
-    if (b.lo <= 0 && b.hi >= 0) {
-        throw std::invalid_argument("Dzielenie przez przedział zawierający zero");
+struct MidRadSplineSegment {
+    MidRad a, b, c, d; // współczynniki lokalne
+    MidRad x;          // początek przedziału
+    MidRad a0, a1, a2; // współczynniki globalne (a3 = d)
+};
+
+// Splajn naturalny w postaci środek-promień (ten sam układ co NaturalCubicSplineInterval)
+class NaturalCubicSplineMidRad {
+private:
+    vector<Interval> x;
+    vector<MidRadSplineSegment> localSegments;
+    vector<IntervalSplineSegment> segments;
+    IntervalKnotIndex index;
+
+    // Wywoływane w trybie FE_UPWARD
+    void build(const vector<MidRad> &xm, const vector<MidRad> &ym) {
+        using namespace interval_arithmetic;
+        int n = xm.size();
+        const MidRad zero = {0.0, 0.0}, one = {1.0, 0.0}, six = {6.0, 0.0};
+        vector<MidRad> h(n - 1);
+        for (int i = 0; i < n - 1; i++) {
+            h[i] = MRSub(xm[i+1], xm[i]);
+            if (h[i].rad >= fabs(h[i].mid)) {
+                throw std::invalid_argument("Przedział h[i] zawiera zero, co uniemożliwia konstrukcję splajnu");
+            }
+        }
+        vector<MidRad> l(n, zero), mu(n, zero), z(n, zero);
+        l[0] = one;
+        for (int i = 1; i < n - 1; i++) {
+            MidRad diff1 = MRDiv( MRSub(ym[i+1], ym[i]), h[i] );
+            MidRad diff2 = MRDiv( MRSub(ym[i], ym[i-1]), h[i-1] );
+            MidRad alpha = MRScale( MRSub(diff1, diff2), 6.0 );
+            l[i] = MRSub( MRScale( MRSub(xm[i+1], xm[i-1]), 2.0 ), MRMul( h[i-1], mu[i-1] ) );
+            mu[i] = MRDiv( h[i], l[i] );
+            z[i] = MRDiv( MRSub(alpha, MRMul( h[i-1], z[i-1] ) ), l[i] );
+        }
+        vector<MidRad> c(n, zero);
+        localSegments.resize(n - 1);
+        for (int j = n - 2; j >= 0; j--) {
+            c[j] = MRSub( z[j], MRMul( mu[j], c[j+1] ) );
+            MidRad term = MRAdd( c[j+1], MRScale( c[j], 2.0 ) );
+            MidRadSplineSegment &s = localSegments[j];
+            s.a = ym[j];
+            s.b = MRSub( MRDiv( MRSub(ym[j+1], ym[j]), h[j] ), MRDiv( MRMul( h[j], term ), six ) );
+            s.c = c[j];
+            s.d = MRDiv( MRSub(c[j+1], c[j]), MRScale( h[j], 6.0 ) );
+            s.x = xm[j];
+            // Postać globalna: a0 = a - b*x + (c/2)*x^2 - d*x^3, a1 = b - c*x + 3*d*x^2,
+            // a2 = c/2 - 3*d*x, a3 = d
+            MidRad x2 = MRMul(s.x, s.x), x3 = MRMul(x2, s.x), c2 = MRScale(s.c, 0.5);
+            s.a0 = MRSub( MRAdd( MRSub( s.a, MRMul(s.b, s.x) ), MRMul(c2, x2) ), MRMul(s.d, x3) );
+            s.a1 = MRAdd( MRSub( s.b, MRMul(s.c, s.x) ), MRScale( MRMul(s.d, x2), 3.0 ) );
+            s.a2 = MRSub( c2, MRScale( MRMul(s.d, s.x), 3.0 ) );
+        }
     }
-    __float128 p1 = a.lo / b.lo;
-    __float128 p2 = a.lo / b.hi;
-    __float128 p3 = a.hi / b.lo;
-    __float128 p4 = a.hi / b.hi;
-    Interval r;
-    r.lo = p1;
-    if (p2 < r.lo) r.lo = p2;
-    if (p3 < r.lo) r.lo = p3;
-    if (p4 < r.lo) r.lo = p4;
-    r.hi = p1;
-    if (p2 > r.hi) r.hi = p2;
-    if (p3 > r.hi) r.hi = p3;
-    if (p4 > r.hi) r.hi = p4;
-    return r;
-}
 
-Interval square(const Interval &a) {
-    return mul(a, a);
-}
+    // Zamiana współczynników na postać [lo, hi] dopiero przy pierwszym użyciu – dolne końce
+    // w jednym przebiegu FE_DOWNWARD, górne w FE_UPWARD
+    void convertSegments() {
+        if (!segments.empty() || localSegments.empty()) return;
+        MidRad MidRadSplineSegment::*from[] = {&MidRadSplineSegment::a, &MidRadSplineSegment::b,
+            &MidRadSplineSegment::c, &MidRadSplineSegment::d, &MidRadSplineSegment::a0,
+            &MidRadSplineSegment::a1, &MidRadSplineSegment::a2, &MidRadSplineSegment::d};
+        Interval IntervalSplineSegment::*to[] = {&IntervalSplineSegment::a, &IntervalSplineSegment::b,
+            &IntervalSplineSegment::c, &IntervalSplineSegment::d, &IntervalSplineSegment::a0,
+            &IntervalSplineSegment::a1, &IntervalSplineSegment::a2, &IntervalSplineSegment::a3};
+        size_t count = localSegments.size();
+        segments.resize(count);
+        fesetround(FE_DOWNWARD);
+        for (size_t i = 0; i < count; i++) {
+            for (int k = 0; k < 8; k++) {
+                const MidRad &v = localSegments[i].*from[k];
+                (segments[i].*to[k]).lo = (__float128) v.mid - v.rad;
+            }
+        }
+        fesetround(FE_UPWARD);
+        for (size_t i = 0; i < count; i++) {
+            for (int k = 0; k < 8; k++) {
+                const MidRad &v = localSegments[i].*from[k];
+                (segments[i].*to[k]).hi = (__float128) v.mid + v.rad;
+            }
+            segments[i].x = x[i];
+        }
+        fesetround(FE_TONEAREST);
+    }
 
-Interval cube(const Interval &a) {
-    return mul(a, square(a));
-}
+public:
+    // Konstruktor przyjmujący wektory przedziałów dla x i y (jak NaturalCubicSplineInterval)
+    NaturalCubicSplineMidRad(const vector<Interval>& x_in, const vector<Interval>& y_in) {
+        x = x_in;
+        index.build(x);
+        int n = x.size();
+        vector<MidRad> xm(n), ym(n);
+        toMidRadBatch(x_in.data(), xm.data(), n);
+        toMidRadBatch(y_in.data(), ym.data(), n);
+        fesetround(FE_UPWARD);
+        try {
+            build(xm, ym);
+        } catch (...) {
+            fesetround(FE_TONEAREST);
+            throw;
+        }
+        fesetround(FE_TONEAREST);
+    }
 
-// Funkcja pomocnicza do wypisywania przedziału jako string "[lo, hi]"
-string toString(const Interval &a) {
-    char bufLo[128], bufHi[128];
-    quadmath_snprintf(bufLo, sizeof(bufLo), "%.18Qe", a.lo);
-    quadmath_snprintf(bufHi, sizeof(bufHi), "%.18Qe", a.hi);
-    string s = "[";
-    s += bufLo; s += ", "; s += bufHi; s += "]";
-    return s;
-}
+    // Obliczenie S(xi) schematem Hornera w postaci środek-promień
+    tuple<Interval, Interval, Interval, Interval, Interval> evaluate(const Interval &xi) {
+        using namespace interval_arithmetic;
+        int n = localSegments.size();
+        if(n == 0) return {I(0.0Q), I(0.0Q), I(0.0Q), I(0.0Q), I(0.0Q)};
+        int seg = index.segment(xi);
+        const MidRadSplineSegment &s = localSegments[seg];
+        MidRad xm = toMidRad(xi);
+        fesetround(FE_UPWARD);
+        MidRad dx = MRSub(xm, s.x);
+        MidRad c2 = MRScale(s.c, 0.5);
+        MidRad value = MRAdd( s.a, MRMul( dx, MRAdd( s.b, MRMul( dx, MRAdd( c2, MRMul( dx, s.d ) ) ) ) ) );
+        fesetround(FE_TONEAREST);
+        return {fromMidRad(value), fromMidRad(s.a), fromMidRad(s.b), fromMidRad(c2), fromMidRad(s.d)};
+    }
 
-struct IntervalSplineSegment {
-    Interval a, b, c, d; // współczynniki lokalne
-    Interval x;          // początek przedziału
-    // współczynniki globalne
-    Interval a0, a1, a2, a3;
+    const vector<MidRadSplineSegment>& getMidRadSegments() const {
+        return localSegments;
+    }
+
+    const vector<IntervalSplineSegment>& getSegments() {
+        convertSegments();
+        return segments;
+    }
+
+    void printCoefficients(ofstream &outputFile) {
+        printIntervalCoefficients(getSegments(), outputFile);
+    }
 };
 
-class NaturalCubicSplineInterval {
+// ====================
+// Tryb adaptacyjny: Interval<double> -> float128 -> Interval<mpreal>
+// ====================
+// Splajn naturalny na przedziałach z interval.h (ten sam układ co NaturalCubicSplineInterval)
+template<typename T>
+class NaturalCubicSplineIA {
 private:
-    vector<Interval> x, y, h;
-    vector<IntervalSplineSegment> segments;
+    typedef interval_arithmetic::Interval<T> IT;
+    vector<IT> x, y, h;
+    vector<IT> a0, a1, a2, a3; // współczynniki globalne segmentów
 public:
-    // Konstruktor przyjmujący wektory przedziałów dla x i y
-    NaturalCubicSplineInterval(const vector<Interval>& x_in, const vector<Interval>& y_in) {
+    NaturalCubicSplineIA(const vector<IT>& x_in, const vector<IT>& y_in) {
+        using namespace interval_arithmetic;
         x = x_in; y = y_in;
         int n = x.size();
         h.resize(n - 1);
         for (int i = 0; i < n - 1; i++) {
-            h[i] = subInt(x[i+1], x[i]);
-            // Sprawdzamy, czy h[i] zawiera zero
-            if (h[i].lo <= 0 && h[i].hi >= 0) {
+            h[i] = ISub(x[i+1], x[i]);
+            if (h[i].a <= 0 && h[i].b >= 0) {
                 throw std::invalid_argument("Przedział h[i] zawiera zero, co uniemożliwia konstrukcję splajnu");
             }
         }
-        // Przygotowanie układu równań – wszystkie zmienne jako przedziały
-        vector<Interval> alpha(n, I(0.0Q)), l(n, I(0.0Q)), mu(n, I(0.0Q)), z(n, I(0.0Q));
-        l[0] = I(1.0Q); mu[0] = I(0.0Q); z[0] = I(0.0Q);
+        // Oba przebiegi w jednym zakresie FE_UPWARD: wyrażenia liczone w całości przez
+        // IEvalScoped, bez zmian trybu na działanie; końce takie same jak z IAdd/ISub/IMul/IDiv
+        RoundingScope<T> up(FE_UPWARD);
+        const T two = 2, three = 3, six = 6;
+        IT zero(0, 0), one(1, 1);
+        vector<IT> l(n, zero), mu(n, zero), z(n, zero);
+        l[0] = one;
         for (int i = 1; i < n - 1; i++) {
-            // alpha[i] = 6 * [ (y[i+1]-y[i])/h[i] - (y[i]-y[i-1])/h[i-1] ]
-            Interval diff1 = divInt( subInt(y[i+1], y[i]), h[i] );
-            Interval diff2 = divInt( subInt(y[i], y[i-1]), h[i-1] );
-            alpha[i] = mul( I(6.0Q), subInt(diff1, diff2) );
-            l[i] = subInt( mul(I(2.0Q), subInt(x[i+1], x[i-1]) ), mul( h[i-1], mu[i-1] ) );
-            mu[i] = divInt( h[i], l[i] );
-            z[i] = divInt( subInt(alpha[i], mul( h[i-1], z[i-1] ) ), l[i] );
+            IT alpha = IEvalScoped( six * ( (ILazy(y[i+1]) - ILazy(y[i])) / ILazy(h[i])
+                                          - (ILazy(y[i]) - ILazy(y[i-1])) / ILazy(h[i-1]) ) );
+            l[i] = IEvalScoped( two * (ILazy(x[i+1]) - ILazy(x[i-1]))
+                                - ILazy(h[i-1]) * ILazy(mu[i-1]) );
+            mu[i] = IDivScoped( h[i], l[i] );
+            z[i] = IEvalScoped( (ILazy(alpha) - ILazy(h[i-1]) * ILazy(z[i-1])) / ILazy(l[i]) );
         }
-        l[n - 1] = I(1.0Q); z[n - 1] = I(0.0Q);
-        vector<Interval> c(n, I(0.0Q)), b(n - 1, I(0.0Q)), d(n - 1, I(0.0Q));
-        c[n - 1] = I(0.0Q);
+        vector<IT> c(n, zero);
+        a0.resize(n - 1); a1.resize(n - 1); a2.resize(n - 1); a3.resize(n - 1);
         for (int j = n - 2; j >= 0; j--) {
-            c[j] = subInt(z[j], mul( mu[j], c[j+1] ) );
-            Interval term = add( c[j+1], mul( I(2.0Q), c[j] ) );
-            b[j] = subInt( divInt( subInt(y[j+1], y[j]), h[j] ),
-                           divInt( mul( h[j], term ), I(6.0Q) ) );
-            d[j] = divInt( subInt(c[j+1], c[j]), mul( I(6.0Q), h[j] ) );
+            c[j] = IEvalScoped( ILazy(z[j]) - ILazy(mu[j]) * ILazy(c[j+1]) );
+            IT b = IEvalScoped( (ILazy(y[j+1]) - ILazy(y[j])) / ILazy(h[j])
+                                - ILazy(h[j]) * (ILazy(c[j+1]) + two * ILazy(c[j])) / six );
+            IT d = IEvalScoped( (ILazy(c[j+1]) - ILazy(c[j])) / (six * ILazy(h[j])) );
+            const IT &xj = x[j];
+            IT x2 = IMulScoped(xj, xj);
+            IT x3 = IMulScoped(x2, xj);
+            a0[j] = IEvalScoped( ILazy(y[j]) - ILazy(b) * ILazy(xj) + ILazy(c[j]) * ILazy(x2) / two
+                                 - ILazy(d) * ILazy(x3) );
+            a1[j] = IEvalScoped( ILazy(b) - ILazy(c[j]) * ILazy(xj)
+                                 + three * (ILazy(d) * ILazy(x2)) );
+            a2[j] = IEvalScoped( ILazy(c[j]) / two - three * (ILazy(d) * ILazy(xj)) );
+            a3[j] = d;
         }
-        // Wypełnienie segmentów – postać lokalna:
-        // S_i(x) = y[i] + b[i]*(x-x[i]) + (c[i]/2)*(x-x[i])^2 + d[i]*(x-x[i])^3.
-        segments.resize(n - 1);
-        for (int i = 0; i < n - 1; i++) {
-            segments[i].a = y[i];
-            segments[i].b = b[i];
-            segments[i].c = c[i]; // przechowujemy c[i] bez dzielenia przez 2
-            segments[i].d = d[i];
-            segments[i].x = x[i];
-            // Przekształcenie do postaci globalnej:
-            // a₀ = a - b*x + (c*x²)/2 - d*x³
-            Interval temp1 = subInt( segments[i].a, mul( segments[i].b, x[i] ) );
-            Interval temp2 = divInt( mul( segments[i].c, square(x[i]) ), I(2.0Q) );
-            Interval temp3 = mul( segments[i].d, cube(x[i]) );
-            segments[i].a0 = subInt( add( temp1, temp2 ), temp3 );
-            // a₁ = b - c*x + 3*d*x²
-            segments[i].a1 = add( subInt( segments[i].b, mul( segments[i].c, x[i] ) ),
-                                  mul( I(3.0Q), mul( segments[i].d, square(x[i]) ) ) );
-            // a₂ = (c/2) - 3*d*x
-            segments[i].a2 = subInt( divInt( segments[i].c, I(2.0Q) ),
-                                    mul( I(3.0Q), mul( segments[i].d, x[i] ) ) );
-            segments[i].a3 = segments[i].d;
+    }
+
+    // Największa szerokość współczynnika globalnego względem największego modułu
+    // współczynników tego samego segmentu. Względem samego siebie współczynnik równy zeru
+    // (wąski przedział wokół zera) miałby szerokość względną 2 przy każdej precyzji.
+    double maxRelativeWidth() const {
+        double worst = 0.0;
+        for (size_t j = 0; j < a0.size(); j++) {
+            double w = 0.0, m = 0.0;
+            for (const IT *v : {&a0[j], &a1[j], &a2[j], &a3[j]}) {
+                w = max(w, static_cast<double>(interval_arithmetic::IntWidth(*v)));
+                m = max(m, max(fabs(static_cast<double>(v->a)), fabs(static_cast<double>(v->b))));
+            }
+            worst = max(worst, m > 0 ? w / m : w);
         }
+        return worst;
     }
-    
-    // Obliczenie S(xi) (postać lokalna) – xi jest przedziałem
-    tuple<Interval, Interval, Interval, Interval, Interval> evaluate(const Interval &xi) {
-        int n = segments.size();
-        if(n == 0) return {I(0.0Q), I(0.0Q), I(0.0Q), I(0.0Q), I(0.0Q)};
-        int seg = 0;
-        // Wybór segmentu analogicznie do trybu 1 – operujemy na dolnych i górnych granicach
-        if(xi.lo < x[0].lo)
-            seg = 0;
-        else if(xi.hi >= x[x.size()-1].hi)
-            seg = x.size()-2;
-        else {
-            for (int i = 0; i < x.size()-1; i++) {
-                if(xi.lo >= x[i].lo && xi.hi < x[i+1].hi) { seg = i; break; }
-            }
-        }
-        Interval dx = subInt(xi, segments[seg].x);
-        Interval term1 = segments[seg].a;
-        Interval term2 = mul(segments[seg].b, dx);
-        Interval term3 = mul( divInt( segments[seg].c, I(2.0Q) ), square(dx) );
-        Interval term4 = mul( segments[seg].d, cube(dx) );
-        Interval value = add( add(term1, term2), add(term3, term4) );
-        return {value, segments[seg].a, segments[seg].b, divInt(segments[seg].c, I(2.0Q)), segments[seg].d};
+
+    const vector<IT>& globalCoefficients(int k) const {
+        return k == 0 ? a0 : (k == 1 ? a1 : (k == 2 ? a2 : a3));
     }
-    
-    // Wypisanie współczynników globalnych – przedziały wypisywane w formacie "[lo, hi]"
-    void printCoefficients(ofstream &outputFile) {
-        const int numCoeff = 4; 
-        int numSegments = segments.size();
-        for (int coeff = 0; coeff < numCoeff; coeff++) {
-            for (int seg = 0; seg < numSegments; seg++) {
-                Interval val;
-                if (coeff == 0)       val = segments[seg].a0;
-                else if (coeff == 1)  val = segments[seg].a1;
-                else if (coeff == 2)  val = segments[seg].a2;
-                else                  val = segments[seg].a3;
-                
-                // Wypisz przedział
-                outputFile << "a[" << coeff << "," << seg << "] = ";
-                IEndsToString(val, outputFile);
-                outputFile << "\n";
-                
-                // Oblicz i wypisz szerokość w formacie X.Xe+X
-                __float128 width = IntWidth(val);
-                char widthBuffer[128];
-                quadmath_snprintf(widthBuffer, sizeof(widthBuffer), "%.1Qe", width);
-                outputFile << "width = " << widthBuffer << "\n\n";
+};
+
+// Zamiana końców na __float128 (dla double dokładna, dla mpreal zaokrąglana na zewnątrz)
+inline Interval toFloat128Interval(const interval_arithmetic::Interval<double> &v) {
+    Interval r; r.lo = v.a; r.hi = v.b; return r;
+}
+
+inline Interval toFloat128Interval(const interval_arithmetic::Interval<mpreal> &v) {
+    Interval r;
+    r.lo = interval_arithmetic::MpfrGetFloat128(v.a.mpfr_srcptr(), MPFR_RNDD);
+    r.hi = interval_arithmetic::MpfrGetFloat128(v.b.mpfr_srcptr(), MPFR_RNDU);
+    return r;
+}
+
+// Dane jednego splajnu jako napisy – każdy poziom precyzji wczytuje je od nowa
+// z własnym zaokrągleniem (dla danych z trybu 2 xLo == xHi i yLo == yHi)
+struct IntervalDataset {
+    vector<string> xLo, xHi, yLo, yHi;
+};
+
+struct AdaptiveSplineResult {
+    int level;                              // 0 - double, 1 - float128, 2 - mpreal
+    double maxRelativeWidth;
+    vector<Interval> a0, a1, a2, a3;        // współczynniki globalne
+};
+
+// Dopasowanie z eskalacją precyzji: najpierw sprzętowe Interval<double>, a dopiero gdy
+// szerokości przekroczą próg (lub konstrukcja się nie powiedzie) – float128, a potem MPFR.
+// Używane w trybie 5.
+class AdaptiveSplineFitter {
+private:
+    double threshold;
+    int mprealBits;
+
+    template<typename T>
+    static vector<interval_arithmetic::Interval<T>> readIA(const vector<string> &lo, const vector<string> &hi) {
+        vector<interval_arithmetic::Interval<T>> r(lo.size());
+        for (size_t i = 0; i < lo.size(); i++) {
+            // LeftRead/RightRead parsują napis dwukrotnie – dla wartości punktowej wystarczy jedno IntRead
+            if (lo[i] == hi[i]) {
+                r[i] = interval_arithmetic::IntRead<T>(lo[i]);
+            } else {
+                r[i].a = interval_arithmetic::LeftRead<T>(lo[i]);
+                r[i].b = interval_arithmetic::RightRead<T>(hi[i]);
+            }
+        }
+        return r;
+    }
+
+    template<typename T>
+    static void storeIA(const NaturalCubicSplineIA<T> &spline, AdaptiveSplineResult &res) {
+        vector<Interval> *out[4] = {&res.a0, &res.a1, &res.a2, &res.a3};
+        for (int k = 0; k < 4; k++) {
+            const auto &src = spline.globalCoefficients(k);
+            out[k]->resize(src.size());
+            for (size_t i = 0; i < src.size(); i++) (*out[k])[i] = toFloat128Interval(src[i]);
+        }
+    }
+
+    // Miara jak w NaturalCubicSplineIA::maxRelativeWidth
+    static double maxRelativeWidth(const vector<IntervalSplineSegment> &segments) {
+        double worst = 0.0;
+        for (const auto &s : segments) {
+            __float128 w = 0.0Q, m = 0.0Q;
+            for (const Interval *v : {&s.a0, &s.a1, &s.a2, &s.a3}) {
+                w = fmaxq(w, IntWidth(*v));
+                m = fmaxq(m, fmaxq(fabsq(v->lo), fabsq(v->hi)));
+            }
+            worst = max(worst, (double) (m > 0 ? w / m : w));
+        }
+        return worst;
+    }
+
+public:
+    // Liczba dopasowań zakończonych na danym poziomie i łączny czas poziomu (w sekundach)
+    long fittedAt[3] = {0, 0, 0};
+    double secondsAt[3] = {0.0, 0.0, 0.0};
+
+    AdaptiveSplineFitter(double widthThreshold, int mprealPrecisionBits = 256)
+        : threshold(widthThreshold), mprealBits(mprealPrecisionBits) {
+        interval_arithmetic::Interval<double>::Initialize();
+    }
+
+    AdaptiveSplineResult fit(const IntervalDataset &data) {
+        AdaptiveSplineResult res;
+        auto t0 = chrono::steady_clock::now();
+        // Poziom 0: Interval<double>
+        try {
+            NaturalCubicSplineIA<double> spline(readIA<double>(data.xLo, data.xHi),
+                                                readIA<double>(data.yLo, data.yHi));
+            res.maxRelativeWidth = spline.maxRelativeWidth();
+            if (res.maxRelativeWidth <= threshold) {
+                res.level = 0;
+                storeIA(spline, res);
+                return finish(res, t0);
+            }
+        } catch (const std::exception &) {
+            // przedział zawierający zero przy niskiej precyzji – próbujemy wyżej
+        }
+        secondsAt[0] += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        t0 = chrono::steady_clock::now();
+        // Poziom 1: __float128 (NaturalCubicSplineInterval)
+        try {
+            vector<Interval> x(data.xLo.size()), y(data.yLo.size());
+            for (size_t i = 0; i < x.size(); i++) { x[i].lo = LeftRead(data.xLo[i]); x[i].hi = RightRead(data.xHi[i]); }
+            for (size_t i = 0; i < y.size(); i++) { y[i].lo = LeftRead(data.yLo[i]); y[i].hi = RightRead(data.yHi[i]); }
+            NaturalCubicSplineInterval spline(x, y);
+            res.maxRelativeWidth = maxRelativeWidth(spline.getSegments());
+            if (res.maxRelativeWidth <= threshold) {
+                res.level = 1;
+                for (const auto &s : spline.getSegments()) {
+                    res.a0.push_back(s.a0); res.a1.push_back(s.a1);
+                    res.a2.push_back(s.a2); res.a3.push_back(s.a3);
+                }
+                return finish(res, t0);
             }
+        } catch (const std::exception &) {
         }
+        secondsAt[1] += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        t0 = chrono::steady_clock::now();
+        // Poziom 2: Interval<mpreal> z zadaną precyzją – wynik zwracamy niezależnie od progu
+        typedef interval_arithmetic::Interval<mpreal> IM;
+        interval_arithmetic::IAPrecision oldPrec = IM::GetPrecision();
+        IM::SetPrecision(static_cast<interval_arithmetic::IAPrecision>(mprealBits));
+        try {
+            NaturalCubicSplineIA<mpreal> spline(readIA<mpreal>(data.xLo, data.xHi),
+                                                readIA<mpreal>(data.yLo, data.yHi));
+            IM::SetPrecision(oldPrec);
+            res.level = 2;
+            res.maxRelativeWidth = spline.maxRelativeWidth();
+            storeIA(spline, res);
+        } catch (...) {
+            IM::SetPrecision(oldPrec);
+            throw;
+        }
+        return finish(res, t0);
+    }
+
+    vector<AdaptiveSplineResult> fitAll(const vector<IntervalDataset> &datasets) {
+        vector<AdaptiveSplineResult> results;
+        results.reserve(datasets.size());
+        for (const auto &d : datasets) results.push_back(fit(d));
+        return results;
+    }
+
+private:
+    AdaptiveSplineResult &finish(AdaptiveSplineResult &res, chrono::steady_clock::time_point t0) {
+        secondsAt[res.level] += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        fittedAt[res.level]++;
+        return res;
     }
 };
 
+// Wypisanie współczynników oraz S(xx) i jego szerokości dla splajnów przedziałowych (tryby 2–4)
+template<typename Spline>
+void writeIntervalResult(Spline &spline, const Interval &xx, ofstream &outputFile) {
+    spline.printCoefficients(outputFile);
+    outputFile << "\n";
+    auto [value, a, b, c, d] = spline.evaluate(xx);
+    outputFile << "S("; IEndsToString(xx, outputFile); outputFile << ") = ";
+    IEndsToString(value, outputFile); outputFile << "\n";
+    __float128 width = IntWidth(value);
+    char widthBuffer[128];
+    quadmath_snprintf(widthBuffer, sizeof(widthBuffer), "%.1Qe", width);
+    outputFile << "width = " << widthBuffer << "\n\n";
+}
+
 // ====================
 // main
 // ====================
 int main() {
+    interval_arithmetic::MpfrLimbPool::Install();
     ifstream inputFile("input.txt");
     ofstream outputFile("output.txt");
     if (!inputFile.is_open() || !outputFile.is_open()) {
@@ -418,8 +3843,77 @@ int main() {
             quadmath_snprintf(buffer, sizeof(buffer), "%.18Qe", value);
             quadmath_snprintf(xxBuffer, sizeof(xxBuffer), "%.18Qe", xx);
             outputFile << "S(" << xxBuffer << ") = " << buffer << "\n\n";
-        } else if (tryb == 3) {
-            // Tryb przedziałowy z jawnymi granicami
+        } else if (tryb == 6) {
+            // Splajn wygładzający: po y parametr lambda (ujemny – wybór przez GCV)
+            vector<__float128> x(n), y(n);
+            for (int i = 0; i < n; i++) {
+                char buffer[128];
+                inputFile >> buffer;
+                x[i] = strtoflt128(buffer, NULL);
+            }
+            for (int i = 0; i < n; i++) {
+                char buffer[128];
+                inputFile >> buffer;
+                y[i] = strtoflt128(buffer, NULL);
+            }
+            SplineSmoothing smoothing;
+            __float128 xx;
+            {
+                char buffer[128];
+                inputFile >> buffer;
+                smoothing.lambda = strtoflt128(buffer, NULL);
+                inputFile >> buffer;
+                xx = strtoflt128(buffer, NULL);
+            }
+            NaturalCubicSpline spline(x, y, smoothing);
+            spline.printCoefficients(outputFile);
+            outputFile << "\n";
+            char buffer[128], xxBuffer[128];
+            quadmath_snprintf(buffer, sizeof(buffer), "%.18Qe", spline.smoothingParameter());
+            outputFile << "lambda = " << buffer << "\n\n";
+            auto [value, a, b, c, d] = spline.evaluate(xx);
+            quadmath_snprintf(buffer, sizeof(buffer), "%.18Qe", value);
+            quadmath_snprintf(xxBuffer, sizeof(xxBuffer), "%.18Qe", xx);
+            outputFile << "S(" << xxBuffer << ") = " << buffer << "\n\n";
+        } else if (tryb == 7) {
+            // Splajn regresyjny: n węzłów, liczba próbek m, próbki x, próbki y, xx
+            vector<__float128> x(n);
+            for (int i = 0; i < n; i++) {
+                char buffer[128];
+                inputFile >> buffer;
+                x[i] = strtoflt128(buffer, NULL);
+            }
+            size_t m;
+            inputFile >> m;
+            vector<__float128> xs(m), ys(m);
+            for (size_t i = 0; i < m; i++) {
+                char buffer[128];
+                inputFile >> buffer;
+                xs[i] = strtoflt128(buffer, NULL);
+            }
+            for (size_t i = 0; i < m; i++) {
+                char buffer[128];
+                inputFile >> buffer;
+                ys[i] = strtoflt128(buffer, NULL);
+            }
+            __float128 xx;
+            {
+                char buffer[128];
+                inputFile >> buffer;
+                xx = strtoflt128(buffer, NULL);
+            }
+            SplineRegression regression(x);
+            regression.add(xs, ys, 0);
+            NaturalCubicSpline spline = regression.solve();
+            spline.printCoefficients(outputFile);
+            outputFile << "\n";
+            char buffer[128], xxBuffer[128];
+            auto [value, a, b, c, d] = spline.evaluate(xx);
+            quadmath_snprintf(buffer, sizeof(buffer), "%.18Qe", value);
+            quadmath_snprintf(xxBuffer, sizeof(xxBuffer), "%.18Qe", xx);
+            outputFile << "S(" << xxBuffer << ") = " << buffer << "\n\n";
+        } else if (tryb == 3 || tryb == 4) {
+            // Tryb przedziałowy z jawnymi granicami (tryb 4 – ten sam format, arytmetyka afiniczna)
             vector<Interval> x(n), y(n);
             for (int i = 0; i < n; i++) {
                 char bufLo[128], bufHi[128];
@@ -440,16 +3934,13 @@ int main() {
                 xx.lo = LeftRead(bufLo);
                 xx.hi = RightRead(bufHi);
             }
-            NaturalCubicSplineInterval spline(x, y);
-            spline.printCoefficients(outputFile);
-            outputFile << "\n";
-            auto [value, a, b, c, d] = spline.evaluate(xx);
-            outputFile << "S("; IEndsToString(xx, outputFile); outputFile << ") = ";
-            IEndsToString(value, outputFile); outputFile << "\n";
-            __float128 width = IntWidth(value);
-            char widthBuffer[128];
-            quadmath_snprintf(widthBuffer, sizeof(widthBuffer), "%.1Qe", width);
-            outputFile << "width = " << widthBuffer << "\n\n";
+            if (tryb == 3) {
+                NaturalCubicSplineInterval spline(x, y);
+                writeIntervalResult(spline, xx, outputFile);
+            } else {
+                NaturalCubicSplineAffine spline(x, y);
+                writeIntervalResult(spline, xx, outputFile);
+            }
         } else if (tryb == 2) {
             // Tryb przedziałowy – konwersja pojedynczej wartości na przedział
             vector<Interval> x(n), y(n);
@@ -470,15 +3961,107 @@ int main() {
                 xx = IntRead(buf);
             }
             NaturalCubicSplineInterval spline(x, y);
-            spline.printCoefficients(outputFile);
-            outputFile << "\n";
-            auto [value, a, b, c, d] = spline.evaluate(xx);
+            writeIntervalResult(spline, xx, outputFile);
+        } else if (tryb == 5) {
+            // Dopasowanie adaptacyjne: dane jak w trybie 3, po y próg względnej szerokości
+            // współczynników, potem xx; precyzja rośnie double -> float128 -> MPFR
+            IntervalDataset data;
+            auto readBounds = [&](vector<string> &lo, vector<string> &hi) {
+                lo.resize(n);
+                hi.resize(n);
+                for (int i = 0; i < n; i++)
+                    inputFile >> lo[i] >> hi[i];
+            };
+            readBounds(data.xLo, data.xHi);
+            readBounds(data.yLo, data.yHi);
+            double threshold;
+            inputFile >> threshold;
+            Interval xx;
+            {
+                char bufLo[128], bufHi[128];
+                inputFile >> bufLo >> bufHi;
+                xx.lo = LeftRead(bufLo);
+                xx.hi = RightRead(bufHi);
+            }
+            AdaptiveSplineFitter fitter(threshold);
+            AdaptiveSplineResult res = fitter.fit(data);
+            vector<IntervalSplineSegment> segments(res.a0.size());
+            for (size_t i = 0; i < segments.size(); i++) {
+                segments[i].a0 = res.a0[i];
+                segments[i].a1 = res.a1[i];
+                segments[i].a2 = res.a2[i];
+                segments[i].a3 = res.a3[i];
+            }
+            printIntervalCoefficients(segments, outputFile);
+            static const char *levels[] = {"double", "float128", "mpreal"};
+            char buffer[128];
+            snprintf(buffer, sizeof(buffer), "%.1e", res.maxRelativeWidth);
+            outputFile << "precyzja = " << levels[res.level] << "\n";
+            outputFile << "maks. względna szerokość = " << buffer << "\n\n";
+            // S(xx) schematem Hornera na współczynnikach globalnych segmentu zawierającego xx
+            Interval value = I(0.0Q);
+            if (!segments.empty()) {
+                vector<Interval> x(n);
+                for (int i = 0; i < n; i++) {
+                    x[i].lo = LeftRead(data.xLo[i]);
+                    x[i].hi = RightRead(data.xHi[i]);
+                }
+                const IntervalSplineSegment &s = segments[IntervalKnotIndex(x).segment(xx)];
+                value = add(s.a0, mul(xx, add(s.a1, mul(xx, add(s.a2, mul(xx, s.a3))))));
+            }
             outputFile << "S("; IEndsToString(xx, outputFile); outputFile << ") = ";
             IEndsToString(value, outputFile); outputFile << "\n";
-            __float128 width = IntWidth(value);
-            char widthBuffer[128];
-            quadmath_snprintf(widthBuffer, sizeof(widthBuffer), "%.1Qe", width);
-            outputFile << "width = " << widthBuffer << "\n\n";
+            quadmath_snprintf(buffer, sizeof(buffer), "%.1Qe", IntWidth(value));
+            outputFile << "width = " << buffer << "\n\n";
+        } else if (tryb >= 8 && tryb <= 10) {
+            // Splajn dwuwymiarowy: nx = n, ny, węzły x, węzły y, wartości z[i*ny + j], punkt
+            // (xx, yy); liczby jak w trybach 1, 2 i 3 (tryb - 7)
+            int ny;
+            inputFile >> ny;
+            if (n < 0 || ny < 0)
+                throw std::invalid_argument("Niepoprawny rozmiar siatki");
+            auto readValue = [&]() -> Interval {
+                char bufLo[128], bufHi[128];
+                inputFile >> bufLo;
+                if (tryb == 8) {
+                    __float128 v = strtoflt128(bufLo, NULL);
+                    return {v, v};
+                }
+                if (tryb == 9)
+                    return IntRead(bufLo);
+                inputFile >> bufHi;
+                Interval r;
+                r.lo = LeftRead(bufLo);
+                r.hi = RightRead(bufHi);
+                return r;
+            };
+            vector<Interval> x(n), y(ny), z((size_t) n * ny);
+            for (auto &v : x) v = readValue();
+            for (auto &v : y) v = readValue();
+            for (auto &v : z) v = readValue();
+            Interval xx = readValue(), yy = readValue();
+            if (tryb == 8) {
+                auto lo = [](const vector<Interval> &v) {
+                    vector<__float128> r(v.size());
+                    for (size_t i = 0; i < v.size(); i++) r[i] = v[i].lo;
+                    return r;
+                };
+                NaturalBicubicSpline spline(lo(x), lo(y), lo(z));
+                char buffer[128], xxBuffer[128], yyBuffer[128];
+                quadmath_snprintf(buffer, sizeof(buffer), "%.18Qe", spline.evaluate(xx.lo, yy.lo));
+                quadmath_snprintf(xxBuffer, sizeof(xxBuffer), "%.18Qe", xx.lo);
+                quadmath_snprintf(yyBuffer, sizeof(yyBuffer), "%.18Qe", yy.lo);
+                outputFile << "S(" << xxBuffer << ", " << yyBuffer << ") = " << buffer << "\n\n";
+            } else {
+                NaturalBicubicSplineInterval spline(x, y, z);
+                Interval value = spline.evaluate(xx, yy);
+                outputFile << "S("; IEndsToString(xx, outputFile); outputFile << ", ";
+                IEndsToString(yy, outputFile); outputFile << ") = ";
+                IEndsToString(value, outputFile); outputFile << "\n";
+                char widthBuffer[128];
+                quadmath_snprintf(widthBuffer, sizeof(widthBuffer), "%.1Qe", IntWidth(value));
+                outputFile << "width = " << widthBuffer << "\n\n";
+            }
         }
         // Zapis statusu w przypadku sukcesu
         outputFile << "Status: 0\n";
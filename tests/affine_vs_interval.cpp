@@ -0,0 +1,120 @@
+/*
+ * affine_vs_interval.cpp
+ *
+ * Porównanie splajnu w arytmetyce afinicznej (tryb 4, NaturalCubicSplineAffine)
+ * ze splajnem przedziałowym (tryb 3, NaturalCubicSplineInterval) dla rosnącej
+ * liczby węzłów n. Dane: x[i] = 10*i/(n-1) ± 1e-10, y[i] = sin(x[i]) ± 1e-6.
+ *
+ * 1. Szerokość wyniku: średnia i największa szerokość S(t) w punktach t leżących
+ *    w środkach segmentów (co najwyżej 64 punkty) oraz stosunek przedziałowy/afiniczny.
+ *    Każda obwiednia musi zawierać wartość splajnu punktowego (tryb 1) dla środków
+ *    danych; w przeciwnym razie program kończy się kodem 1.
+ * 2. Czas: konstrukcja splajnu i obliczenie S(t) w tych punktach (µs), średnio
+ *    z powtórzeń trwających łącznie co najmniej 0,1 s.
+ * Formy afiniczne mają co najwyżej AffineForm::maxTerms symboli (domyślnie 12);
+ * pozostałe trafiają do składnika err.
+ *
+ * Budowanie i uruchomienie (z katalogu głównego repozytorium):
+ *   g++ -std=gnu++17 -O2 -I. tests/affine_vs_interval.cpp -o affine_vs_interval \
+ *       -lmpfr -lgmp -lquadmath -lpthread
+ *   ./affine_vs_interval
+ */
+
+#define main spline_main
+#include "../main.cpp"
+#undef main
+#include <cstdio>
+
+static const __float128 X_RADIUS = 1e-10Q, Y_RADIUS = 1e-6Q;
+
+struct Widths {
+    double mean = 0.0, max = 0.0;
+};
+
+struct Dataset {
+    vector<__float128> xMid, yMid, t;
+    vector<Interval> x, y;
+};
+
+static Dataset makeDataset(int n) {
+    Dataset d;
+    for (int i = 0; i < n; i++) {
+        __float128 xi = 10.0Q * (__float128) i / (__float128) (n - 1);
+        d.xMid.push_back(xi);
+        d.yMid.push_back(sinq(xi));
+        d.x.push_back({xi - X_RADIUS, xi + X_RADIUS});
+        d.y.push_back({sinq(xi) - Y_RADIUS, sinq(xi) + Y_RADIUS});
+    }
+    int step = max(1, (n - 1) / 64);
+    for (int i = 0; i + 1 < n; i += step)
+        d.t.push_back((d.xMid[i] + d.xMid[i+1]) / 2.0Q);
+    return d;
+}
+
+static int failures = 0;
+
+// Szerokości S(t) i sprawdzenie, że zawierają splajn punktowy
+template<typename Spline>
+static Widths measureWidths(Spline &spline, NaturalCubicSpline &exact, const Dataset &d) {
+    Widths w;
+    for (__float128 t : d.t) {
+        Interval value = get<0>(spline.evaluate(I(t)));
+        __float128 s = get<0>(exact.evaluate(t));
+        if (!(value.lo <= s && s <= value.hi))
+            failures++;
+        double width = (double) (value.hi - value.lo);
+        w.mean += width / (double) d.t.size();
+        w.max = max(w.max, width);
+    }
+    return w;
+}
+
+// Czas konstrukcji i obliczeń w µs
+template<typename Spline>
+static double measureTime(const Dataset &d) {
+    long repeats = 0;
+    double sink = 0.0;
+    auto t0 = chrono::steady_clock::now();
+    double seconds = 0.0;
+    while (seconds < 0.1) {
+        Spline spline(d.x, d.y);
+        for (__float128 t : d.t)
+            sink += (double) get<0>(spline.evaluate(I(t))).hi;
+        repeats++;
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    }
+    if (sink != sink)
+        failures++;
+    return seconds * 1e6 / (double) repeats;
+}
+
+int main() {
+    const int SIZES[] = {4, 8, 16, 32, 64, 128, 256, 512, 1024};
+
+    printf("Szerokość S(t) w środkach segmentów (x ± %.0e, y ± %.0e)\n",
+           (double) X_RADIUS, (double) Y_RADIUS);
+    printf("%6s %12s %12s %12s %12s %10s\n", "n", "tryb 3 śr.", "tryb 3 maks.",
+           "tryb 4 śr.", "tryb 4 maks.", "3/4 śr.");
+    for (int n : SIZES) {
+        Dataset d = makeDataset(n);
+        NaturalCubicSpline exact(d.xMid, d.yMid);
+        NaturalCubicSplineInterval interval(d.x, d.y);
+        NaturalCubicSplineAffine affine(d.x, d.y);
+        Widths wi = measureWidths(interval, exact, d);
+        Widths wa = measureWidths(affine, exact, d);
+        printf("%6d %12.3e %12.3e %12.3e %12.3e %10.2f\n", n, wi.mean, wi.max,
+               wa.mean, wa.max, wi.mean / wa.mean);
+    }
+
+    printf("\nCzas konstrukcji i obliczenia S(t) [µs]\n");
+    printf("%6s %12s %12s %10s\n", "n", "tryb 3", "tryb 4", "4/3");
+    for (int n : SIZES) {
+        Dataset d = makeDataset(n);
+        double ti = measureTime<NaturalCubicSplineInterval>(d);
+        double ta = measureTime<NaturalCubicSplineAffine>(d);
+        printf("%6d %12.1f %12.1f %10.2f\n", n, ti, ta, ta / ti);
+    }
+
+    printf("\nobwiednie bez wartości splajnu punktowego: %d\n", failures);
+    return failures != 0 ? 1 : 0;
+}
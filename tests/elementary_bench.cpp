@@ -0,0 +1,362 @@
+/*
+ * elementary_bench.cpp
+ *
+ * Sprawdzenie i pomiar przedziałowych funkcji elementarnych z interval.h
+ * (ISin, ICos, IExp, ILog, ISqrt oraz ich wersji paczkowych).
+ *
+ * 1. Weryfikacja względem MPFR: dla losowych punktów z kilku skal wynik musi
+ *    zawierać wartość liczoną z precyzją 300 bitów; dla przedziałów sin/cos
+ *    dodatkowo wartości w punktach próbkowanych i w ekstremach k*pi/2.
+ *    Każde naruszenie kończy program kodem 1.
+ * 2. Przepustowość (mln operacji/s) nowych funkcji oraz dawnych szeregów
+ *    Taylora (przepisane z wersji sprzed zmiany z tą samą logiką, przestrzeń
+ *    old_elementary).
+ *    Dawne ISin/ICos/IExp dla double nie kończą obliczeń, dlatego mierzone są
+ *    tylko dla long double i na krótszej próbce.
+ *
+ * Budowanie i uruchomienie (z katalogu głównego repozytorium):
+ *   g++ -std=gnu++17 -O2 -I. tests/elementary_bench.cpp -o elementary_bench -lmpfr -lgmp
+ *   ./elementary_bench [liczba_punktów_na_skalę]
+ */
+
+#define MPFR_USE_NO_MACRO
+#define MPFR_USE_INTMAX_T
+#include "interval.h"
+#include <chrono>
+#include <random>
+#include <cstdio>
+
+using interval_arithmetic::Interval;
+namespace ia = interval_arithmetic;
+
+namespace old_elementary {
+
+template<typename T>
+Interval<T> ClampUnit(Interval<T> w) {
+    if (w.b > 1) {
+        w.b = 1;
+        if (w.a > 1)
+            w.a = 1;
+    }
+    if (w.a < -1) {
+        w.a = -1;
+        if (w.b < -1)
+            w.b = -1;
+    }
+    return w;
+}
+
+// Dawne implementacje: szereg Taylora bez redukcji argumentu, kończony, gdy
+// względna zmiana obu końców spadnie poniżej 1e-18
+template<typename T>
+Interval<T> OldSin(const Interval<T> &x) {
+    const T eps = 1E-18;
+    if (x.a > x.b)
+        return Interval<T>(0, 0);
+    Interval<T> d, s = x, w = x, w1;
+    Interval<T> x2 = ia::IMul(x, x);
+    bool is_even = true;
+    for (int k = 1; k <= INT_MAX / 2; k += 2) {
+        d.a = (k + 1) * (k + 2);
+        d.b = d.a;
+        s = ia::IMul(s, ia::IDiv(x2, d));
+        w1 = is_even ? ia::ISub(w, s) : ia::IAdd(w, s);
+        if ((w.a == 0) && (w.b == 0))
+            return Interval<T>(0, 0);
+        bool finished;
+        if ((w.a != 0) && (w.b != 0))
+            finished = (abs(w.a - w1.a) / abs(w.a) < eps) && (abs(w.b - w1.b) / abs(w.b) < eps);
+        else if (w.a == 0)
+            finished = (abs(w.a - w1.a) < eps) && (abs(w.b - w1.b) / abs(w.b) < eps);
+        else
+            finished = (abs(w.a - w1.a) / abs(w.a) < eps || abs(w.a - w1.a) < eps)
+                    && (abs(w.b - w1.b) < eps);
+        if (finished)
+            return ClampUnit(w1);
+        w = w1;
+        is_even = !is_even;
+    }
+    return Interval<T>(0, 0);
+}
+
+template<typename T>
+Interval<T> OldCos(const Interval<T> &x) {
+    const T eps = 1E-18;
+    Interval<T> d, c(1, 1), w(1, 1), w1;
+    Interval<T> x2 = ia::IMul(x, x);
+    bool is_even = true;
+    for (int k = 1; k <= INT_MAX / 2; k += 2) {
+        d.a = k * (k + 1);
+        d.b = d.a;
+        c = ia::IMul(c, ia::IDiv(x2, d));
+        w1 = is_even ? ia::ISub(w, c) : ia::IAdd(w, c);
+        bool finished;
+        if ((w.a != 0) && (w.b != 0))
+            finished = (abs(w.a - w1.a) / abs(w.a) < eps) && (abs(w.b - w1.b) / abs(w.b) < eps);
+        else if (w.a == 0 && w.b != 0)
+            finished = (abs(w.a - w1.a) < eps) && (abs(w.b - w1.b) / abs(w.b) < eps);
+        else if (w.a != 0)
+            finished = (abs(w.a - w1.a) / abs(w.a) < eps) && (abs(w.b - w1.b) < eps);
+        else
+            finished = (abs(w.a - w1.a) < eps) && (abs(w.b - w1.b) < eps);
+        if (finished)
+            return ClampUnit(w1);
+        w = w1;
+        is_even = !is_even;
+    }
+    return Interval<T>(0, 0);
+}
+
+template<typename T>
+Interval<T> OldExp(const Interval<T> &x) {
+    const T eps = 1E-18;
+    if ((x.a < 0) && (x.b > 0))
+        return Interval<T>(1, 1);
+    if (x.a > x.b)
+        return Interval<T>(0, 0);
+    Interval<T> d, e(1, 1), w(1, 1), w1;
+    for (int k = 1; k <= INT_MAX / 2; k++) {
+        d.a = k;
+        d.b = k;
+        e = ia::IMul(e, ia::IDiv(x, d));
+        w1 = ia::IAdd(w, e);
+        if ((abs(w.a - w1.a) / abs(w.a) < eps) && (abs(w.b - w1.b) / abs(w.b) < eps))
+            return w1;
+        w = w1;
+    }
+    return Interval<T>(0, 0);
+}
+
+// Dawny ISqrt: pierwiastek w dwóch trybach zaokrąglania
+template<typename T>
+Interval<T> OldSqrt(const Interval<T> &x, int &st) {
+    Interval<T> r(0, 0);
+    if (x.a > x.b) {
+        st = 1;
+    } else if (x.a < 0) {
+        st = 2;
+    } else {
+        st = 0;
+        ia::SetRounding<T>(FE_DOWNWARD);
+        r.a = std::sqrt(x.a);
+        ia::SetRounding<T>(FE_UPWARD);
+        r.b = std::sqrt(x.b);
+        ia::SetRounding<T>(FE_TONEAREST);
+    }
+    return r;
+}
+
+} // namespace old_elementary
+
+enum Function {
+    F_SIN, F_COS, F_EXP, F_LOG, F_SQRT, F_COUNT
+};
+
+static const char *functionNames[F_COUNT] = { "sin", "cos", "exp", "log", "sqrt" };
+
+template<typename T>
+static Interval<T> evaluate(Function f, const Interval<T> &x) {
+    int st;
+    switch (f) {
+    case F_SIN:
+        return ia::ISin(x);
+    case F_COS:
+        return ia::ICos(x);
+    case F_EXP:
+        return ia::IExp(x);
+    case F_LOG:
+        return ia::ILog(x, st);
+    default:
+        return ia::ISqrt(x, st);
+    }
+}
+
+// Wartość funkcji w punkcie z precyzją 300 bitów; float, double i long double
+// mieszczą się dokładnie w long double
+static void reference(Function f, long double x, mpfr_t out) {
+    mpfr_t v;
+    mpfr_init2(v, 64);
+    mpfr_set_ld(v, x, MPFR_RNDN);
+    switch (f) {
+    case F_SIN:
+        mpfr_sin(out, v, MPFR_RNDN);
+        break;
+    case F_COS:
+        mpfr_cos(out, v, MPFR_RNDN);
+        break;
+    case F_EXP:
+        mpfr_exp(out, v, MPFR_RNDN);
+        break;
+    case F_LOG:
+        mpfr_log(out, v, MPFR_RNDN);
+        break;
+    default:
+        mpfr_sqrt(out, v, MPFR_RNDN);
+        break;
+    }
+    mpfr_clear(v);
+}
+
+template<typename T>
+static double widthInUlps(const Interval<T> &r) {
+    T m = std::max(std::fabs(r.a), std::fabs(r.b));
+    if (m == 0)
+        return 0;
+    int e;
+    std::frexp(m, &e);
+    return (double) ((r.b - r.a) / std::ldexp((T) 1, e - std::numeric_limits<T>::digits));
+}
+
+template<typename T>
+static long verifyPoints(const char *type, int perScale) {
+    static const double trigScales[] = { 1e-8, 1, 30, 1e5, 1e12 };
+    static const double expScales[] = { 1e-8, 1, 30, 80, 80 };
+    static const double positiveScales[] = { 1e-8, 1, 30, 1e5, 1e30 };
+    std::mt19937_64 gen(42);
+    mpfr_t v;
+    mpfr_init2(v, 300);
+    long total = 0;
+    for (int f = 0; f < F_COUNT; f++) {
+        const double *scales = f <= F_COS ? trigScales : f == F_EXP ? expScales : positiveScales;
+        long bad = 0, count = 0;
+        double maxUlps = 0, sumUlps = 0;
+        for (int s = 0; s < 5; s++) {
+            std::uniform_real_distribution<double> dist(-scales[s], scales[s]);
+            for (int i = 0; i < perScale; i++) {
+                T x = (T) dist(gen);
+                if (f >= F_LOG)
+                    x = std::fabs(x);
+                if (f == F_LOG && x == 0)
+                    continue;
+                Interval<T> r = evaluate<T>((Function) f, Interval<T>(x, x));
+                reference((Function) f, (long double) x, v);
+                if (mpfr_cmp_ld(v, (long double) r.a) < 0 || mpfr_cmp_ld(v, (long double) r.b) > 0) {
+                    if (bad++ < 3)
+                        printf("  naruszenie %s(%.21Lg): [%.21Lg, %.21Lg]\n", functionNames[f],
+                                (long double) x, (long double) r.a, (long double) r.b);
+                }
+                double u = widthInUlps(r);
+                maxUlps = std::max(maxUlps, u);
+                sumUlps += u;
+                count++;
+            }
+        }
+        printf("%-12s %-4s punkty: naruszenia %ld, szerokość w ulp maks. %.1f, średnio %.2f\n",
+                type, functionNames[f], bad, maxUlps, sumUlps / count);
+        total += bad;
+    }
+    mpfr_clear(v);
+    return total;
+}
+
+// Przedziały sin/cos: wynik musi zawierać wartości w 65 punktach próbkowanych
+// oraz we wszystkich ekstremach k*pi/2 leżących w przedziale
+template<typename T>
+static long verifyIntervals(const char *type, int count) {
+    std::mt19937_64 gen(7);
+    std::uniform_real_distribution<double> center(-50, 50), exponent(-12, 1);
+    mpfr_t v;
+    mpfr_init2(v, 300);
+    long bad = 0;
+    for (int f = F_SIN; f <= F_COS; f++) {
+        for (int i = 0; i < count; i++) {
+            T a = (T) center(gen);
+            T b = (T) (a + std::pow(10.0, exponent(gen)));
+            Interval<T> r = evaluate<T>((Function) f, Interval<T>(a, b));
+            bool ok = true;
+            for (int j = 0; j <= 64 && ok; j++) {
+                long double x = j == 64 ? (long double) b
+                        : (long double) a + ((long double) b - (long double) a) * j / 64;
+                reference((Function) f, x, v);
+                ok = mpfr_cmp_ld(v, (long double) r.a) >= 0 && mpfr_cmp_ld(v, (long double) r.b) <= 0;
+            }
+            long first = (long) std::floor((long double) a / M_PI_2l) - 1;
+            long last = (long) std::ceil((long double) b / M_PI_2l) + 1;
+            for (long k = first; k <= last && ok; k++) {
+                long double x = k * M_PI_2l;
+                if (x < (long double) a || x > (long double) b)
+                    continue;
+                reference((Function) f, x, v);
+                ok = mpfr_cmp_ld(v, (long double) r.a) >= 0 && mpfr_cmp_ld(v, (long double) r.b) <= 0;
+            }
+            if (!ok && bad++ < 3)
+                printf("  naruszenie %s([%.21Lg, %.21Lg]): [%.21Lg, %.21Lg]\n", functionNames[f],
+                        (long double) a, (long double) b, (long double) r.a, (long double) r.b);
+        }
+    }
+    printf("%-12s sin/cos przedziały: naruszenia %ld\n", type, bad);
+    mpfr_clear(v);
+    return bad;
+}
+
+template<typename F>
+static double mopsPerSecond(size_t n, F body) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return n / elapsed.count() / 1e6;
+}
+
+// Przedziały szerokości 1e-9 o środkach z [-10, 10]; dla log i sqrt przesunięte do [1, 11]
+template<typename T>
+static void bench(const char *type, bool withOld) {
+    const size_t n = 1000000, nOld = 2000;
+    std::mt19937_64 gen(3);
+    std::uniform_real_distribution<double> dist(-10, 10);
+    vector<Interval<T> > xs(n), xp(n), out(n);
+    for (size_t i = 0; i < n; i++) {
+        T c = (T) dist(gen);
+        xs[i] = Interval<T>(c, c + (T) 1e-9);
+        xp[i] = Interval<T>(std::fabs(c) + 1, std::fabs(c) + 1 + (T) 1e-9);
+    }
+    int st;
+    double scalar[F_COUNT], batch[F_COUNT], old[F_COUNT] = { 0, 0, 0, 0, 0 };
+    scalar[F_SIN] = mopsPerSecond(n, [&] { for (size_t i = 0; i < n; i++) out[i] = ia::ISin(xs[i]); });
+    scalar[F_COS] = mopsPerSecond(n, [&] { for (size_t i = 0; i < n; i++) out[i] = ia::ICos(xs[i]); });
+    scalar[F_EXP] = mopsPerSecond(n, [&] { for (size_t i = 0; i < n; i++) out[i] = ia::IExp(xs[i]); });
+    scalar[F_LOG] = mopsPerSecond(n, [&] { for (size_t i = 0; i < n; i++) out[i] = ia::ILog(xp[i], st); });
+    scalar[F_SQRT] = mopsPerSecond(n, [&] { for (size_t i = 0; i < n; i++) out[i] = ia::ISqrt(xp[i], st); });
+    batch[F_SIN] = mopsPerSecond(n, [&] { ia::ISinBatch(xs.data(), out.data(), n); });
+    batch[F_COS] = mopsPerSecond(n, [&] { ia::ICosBatch(xs.data(), out.data(), n); });
+    batch[F_EXP] = mopsPerSecond(n, [&] { ia::IExpBatch(xs.data(), out.data(), n); });
+    batch[F_LOG] = mopsPerSecond(n, [&] { ia::ILogBatch(xp.data(), out.data(), n, st); });
+    batch[F_SQRT] = mopsPerSecond(n, [&] { ia::ISqrtBatch(xp.data(), out.data(), n, st); });
+    old[F_SQRT] = mopsPerSecond(n, [&] { for (size_t i = 0; i < n; i++) out[i] = old_elementary::OldSqrt(xp[i], st); });
+    if (withOld) {
+        old[F_SIN] = mopsPerSecond(nOld, [&] { for (size_t i = 0; i < nOld; i++) out[i] = old_elementary::OldSin(xs[i]); });
+        old[F_COS] = mopsPerSecond(nOld, [&] { for (size_t i = 0; i < nOld; i++) out[i] = old_elementary::OldCos(xs[i]); });
+        old[F_EXP] = mopsPerSecond(nOld, [&] { for (size_t i = 0; i < nOld; i++) out[i] = old_elementary::OldExp(xs[i]); });
+    }
+    printf("%-12s mln op./s    dawna   nowa  paczka\n", type);
+    for (int f = 0; f < F_COUNT; f++) {
+        if (old[f] > 0)
+            printf("             %-4s %8.3f %6.2f %7.2f\n", functionNames[f], old[f], scalar[f], batch[f]);
+        else
+            printf("             %-4s %8s %6.2f %7.2f\n", functionNames[f], "-", scalar[f], batch[f]);
+    }
+}
+
+int main(int argc, char **argv) {
+    int perScale = argc > 1 ? atoi(argv[1]) : 20000;
+    Interval<float>::Initialize();
+    Interval<double>::Initialize();
+    Interval<long double>::Initialize();
+
+    long bad = 0;
+    bad += verifyPoints<float>("float", perScale);
+    bad += verifyPoints<double>("double", perScale);
+    bad += verifyPoints<long double>("long double", perScale);
+    bad += verifyIntervals<float>("float", perScale);
+    bad += verifyIntervals<double>("double", perScale);
+    bad += verifyIntervals<long double>("long double", perScale);
+
+    bench<double>("double", false);
+    bench<long double>("long double", true);
+
+    if (bad != 0) {
+        printf("BŁĄD: %ld naruszeń zawierania\n", bad);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
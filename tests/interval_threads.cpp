@@ -0,0 +1,129 @@
+/*
+ * interval_threads.cpp
+ *
+ * Test obciążeniowy ustawień Interval<T> przechowywanych osobno dla każdego wątku
+ * (IAContext, ContextScope). Wątki naprzemiennie pracują w trybie PINT i DINT oraz
+ * z precyzją mpreal 80 i 200 bitów; każdy wynik musi być identyczny z wynikiem
+ * obliczonym wcześniej jednowątkowo z tymi samymi ustawieniami, a ustawienia
+ * wątku nie mogą się zmienić pod wpływem pozostałych wątków. Sprawdzane jest też,
+ * że instalacja kontekstu Interval<double> (z inną precyzją) po kontekście
+ * Interval<mpreal> nie zmienia domyślnej precyzji mpreal.
+ * Program kończy się kodem 1, gdy którekolwiek porównanie się nie powiedzie.
+ *
+ * Budowanie z ThreadSanitizer i uruchomienie (z katalogu głównego repozytorium);
+ * TSan nie powinien zgłosić żadnego wyścigu:
+ *   g++ -std=gnu++17 -O1 -g -fsanitize=thread -I. tests/interval_threads.cpp \
+ *       -o interval_threads -lmpfr -lgmp -lpthread
+ *   ./interval_threads [liczba_wątków]
+ */
+
+#define MPFR_USE_NO_MACRO
+#define MPFR_USE_INTMAX_T
+#include "interval.h"
+#include <thread>
+#include <atomic>
+#include <cstdio>
+
+using namespace interval_arithmetic;
+
+static const int ITERATIONS = 30;
+static const IAPrecision PRECISIONS[2] = { (IAPrecision) 80, (IAPrecision) 200 };
+static const IAPrecision DOUBLE_PRECISIONS[2] = { DOUBLE_PREC, LONGDOUBLE_PREC };
+
+// Rekurencja z mnożeniem, dodawaniem i dzieleniem przedziałów; wynik zależy od
+// trybu (PINT/DINT) i dla mpreal od precyzji bieżącego wątku
+template<typename T>
+static Interval<T> work(int seed) {
+    Interval<T> acc(T(1), T(1));
+    Interval<T> x(T(seed) / T(7), T(seed) / T(7) + T(1) / T(1000));
+    Interval<T> third(T(1) / T(3), T(1) / T(3));
+    Interval<T> divisor(T(2), T(3));
+    for (int k = 0; k < 200; k++) {
+        acc = acc * x + third;
+        acc = acc / divisor;
+    }
+    return acc;
+}
+
+template<typename T>
+static bool same(const Interval<T> &p, const Interval<T> &q) {
+    return p.a == q.a && p.b == q.b;
+}
+
+// Precyzje kontekstów double i mpreal celowo się różnią, żeby wykryć przeciek
+// precyzji jednego typu do drugiego
+template<typename T>
+static IAContext<T> contextFor(int variant) {
+    IAContext<T> c = IAContext<T>::Current();
+    c.mode = variant ? DINT_MODE : PINT_MODE;
+    c.precision = std::is_same<T, mpreal>::value ? PRECISIONS[variant] : DOUBLE_PRECISIONS[variant];
+    return c;
+}
+
+int main(int argc, char **argv) {
+    unsigned threads = argc > 1 ? (unsigned) atoi(argv[1])
+            : std::max(4u, std::thread::hardware_concurrency());
+    Interval<double>::Initialize();
+    Interval<mpreal>::Initialize();
+
+    // Wyniki wzorcowe liczone w wątku głównym; ContextScope przywraca ustawienia
+    Interval<double> expectedDouble[2];
+    Interval<mpreal> expectedMpreal[2];
+    for (int v = 0; v < 2; v++) {
+        {
+            ContextScope<double> scope(contextFor<double>(v));
+            expectedDouble[v] = work<double>(3);
+        }
+        {
+            ContextScope<mpreal> scope(contextFor<mpreal>(v));
+            expectedMpreal[v] = work<mpreal>(3);
+        }
+    }
+    IAMode mainMode = Interval<double>::GetMode();
+
+    std::atomic<int> failures(0);
+    // Kontekst double zainstalowany po kontekście mpreal (bezpośrednio i przez
+    // ContextScope) nie może zmienić domyślnej precyzji mpreal
+    for (int v = 0; v < 2; v++) {
+        ContextScope<double> restoreDouble(IAContext<double>::Current());
+        ContextScope<mpreal> scopeMpreal(contextFor<mpreal>(v));
+        {
+            ContextScope<double> scopeDouble(contextFor<double>(1 - v));
+            if (mpreal().get_prec() != PRECISIONS[v])
+                failures++;
+        }
+        if (mpreal().get_prec() != PRECISIONS[v])
+            failures++;
+        contextFor<double>(v).Install();
+        if (mpreal().get_prec() != PRECISIONS[v] || !same(work<mpreal>(3), expectedMpreal[v]))
+            failures++;
+    }
+    vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            int v = t & 1;
+            IAContext<double> contextDouble = contextFor<double>(v);
+            IAContext<mpreal> contextMpreal = contextFor<mpreal>(v);
+            contextMpreal.Install();
+            contextDouble.Install();
+            for (int it = 0; it < ITERATIONS; it++) {
+                if (!same(work<double>(3), expectedDouble[v]))
+                    failures++;
+                if (!same(work<mpreal>(3), expectedMpreal[v]))
+                    failures++;
+                if (mpreal().get_prec() != PRECISIONS[v])
+                    failures++;
+                if (Interval<double>::GetMode() != contextDouble.mode
+                        || Interval<mpreal>::GetPrecision() != contextMpreal.precision)
+                    failures++;
+            }
+        });
+    }
+    for (auto &w : workers)
+        w.join();
+    if (Interval<double>::GetMode() != mainMode)
+        failures++;
+
+    printf("wątki: %u, błędy: %d\n", threads, failures.load());
+    return failures != 0 ? 1 : 0;
+}
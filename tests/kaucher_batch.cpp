@@ -0,0 +1,189 @@
+/*
+ * kaucher_batch.cpp
+ *
+ * Porównanie paczkowych działań Kauchera w układzie SoA (DIAddBatch, DISubBatch,
+ * DIMulBatch, DIDivBatch) z działaniami skalarnymi DIAdd, DISub, DIMul, DIDiv.
+ * Dla float, double i long double oraz trybów PINT i DINT losowane są pary
+ * przedziałów właściwych i niewłaściwych (także z końcami równymi 0, równymi sobie
+ * i z różnych skal); każdy koniec wyniku paczki musi być równy końcowi wyniku
+ * skalarnego (-0 i +0 uznajemy za równe).
+ * Dzielenie dostaje dzielniki bez zera, a osobna paczka z jednym dzielnikiem
+ * zawierającym 0 musi zgłosić wyjątek jak DIDiv. Każda niezgodność kończy
+ * program kodem 1.
+ *
+ * Budowanie i uruchomienie (z katalogu głównego repozytorium; przy -O3 GCC zwija
+ * |b - a| w skalarnym DIntWidth, więc odniesienie liczy się przy -O2):
+ *   g++ -std=gnu++17 -O2 -I. tests/kaucher_batch.cpp -o kaucher_batch -lmpfr -lgmp
+ *   ./kaucher_batch [liczba_par]
+ */
+
+#define MPFR_USE_NO_MACRO
+#define MPFR_USE_INTMAX_T
+#include "interval.h"
+#include <random>
+#include <cstdio>
+
+using namespace interval_arithmetic;
+
+static std::mt19937_64 rng(32);
+
+// Koniec przedziału: 0, ±1 albo liczba losowa ze skali 2^-20 .. 2^20
+template<typename T>
+static T randomEnd() {
+    std::uniform_int_distribution<int> kind(0, 9);
+    std::uniform_real_distribution<double> u(-1.0, 1.0);
+    int k = kind(rng);
+    if (k == 0)
+        return T(0);
+    if (k == 1)
+        return T(u(rng) < 0 ? -1 : 1);
+    return T(u(rng)) * std::ldexp(T(1), std::uniform_int_distribution<int>(-20, 20)(rng));
+}
+
+// Przedział właściwy lub (z prawdopodobieństwem 1/2) niewłaściwy; czasem zdegenerowany.
+// nonzero – oba końce tego samego znaku, bez zera (dzielnik)
+template<typename T>
+static Interval<T> randomInterval(bool nonzero) {
+    T p = randomEnd<T>(), q = randomEnd<T>();
+    if (std::uniform_int_distribution<int>(0, 15)(rng) == 0)
+        q = p;
+    if (nonzero) {
+        while (p == 0)
+            p = randomEnd<T>();
+        while (q == 0)
+            q = randomEnd<T>();
+        if ((p < 0) != (q < 0))
+            q = -q;
+    }
+    if ((p > q) != (std::uniform_int_distribution<int>(0, 1)(rng) == 1))
+        std::swap(p, q);
+    return Interval<T>(p, q);
+}
+
+// Równość wartości; -0 i +0 to ten sam koniec przedziału (DIMul i KaucherMul* dochodzą
+// do zera różnymi drogami, więc znak zera bywa inny)
+template<typename T>
+static bool same(T u, T v) {
+    return u == v || (u != u && v != v);
+}
+
+static const char *OP_NAMES[4] = {"DIAdd", "DISub", "DIMul", "DIDiv"};
+
+template<typename T>
+static Interval<T> scalar(int op, const Interval<T> &x, const Interval<T> &y) {
+    switch (op) {
+    case 0:
+        return DIAdd(x, y);
+    case 1:
+        return DISub(x, y);
+    case 2:
+        return DIMul(x, y);
+    default:
+        return DIDiv(x, y);
+    }
+}
+
+template<typename T>
+static void batch(int op, const IntervalArray<T> &x, const IntervalArray<T> &y,
+        IntervalArray<T> &r) {
+    switch (op) {
+    case 0:
+        DIAddBatch(x, y, r);
+        break;
+    case 1:
+        DISubBatch(x, y, r);
+        break;
+    case 2:
+        DIMulBatch(x, y, r);
+        break;
+    default:
+        DIDivBatch(x, y, r);
+        break;
+    }
+}
+
+// Liczba niezgodności dla jednego typu, trybu i działania
+template<typename T>
+static long compare(const char *type, IAMode mode, int op, size_t n) {
+    Interval<T>::SetMode(mode);
+    IntervalArray<T> x(n), y(n), r;
+    for (size_t i = 0; i < n; i++) {
+        x.Set(i, randomInterval<T>(false));
+        y.Set(i, randomInterval<T>(op == 3));
+    }
+    batch(op, x, y, r);
+    long bad = 0;
+    for (size_t i = 0; i < n; i++) {
+        Interval<T> s = scalar(op, x.Get(i), y.Get(i));
+        if (same(s.a, r.a[i]) && same(s.b, r.b[i]))
+            continue;
+        if (bad++ < 3)
+            printf("  %s<%s> %s: [%.21Lg, %.21Lg] op [%.21Lg, %.21Lg]\n"
+                   "    skalarnie [%.21Lg, %.21Lg], paczka [%.21Lg, %.21Lg]\n",
+                   OP_NAMES[op], type, mode == DINT_MODE ? "DINT" : "PINT",
+                   (long double) x.a[i], (long double) x.b[i],
+                   (long double) y.a[i], (long double) y.b[i],
+                   (long double) s.a, (long double) s.b,
+                   (long double) r.a[i], (long double) r.b[i]);
+    }
+    return bad;
+}
+
+// Paczka z jednym dzielnikiem zawierającym 0: wyjątek jak w DIDiv, pozostałe wyniki
+// policzone
+template<typename T>
+static long divisionByZero(size_t n) {
+    IntervalArray<T> x(n), y(n), r;
+    for (size_t i = 0; i < n; i++) {
+        x.Set(i, randomInterval<T>(false));
+        y.Set(i, randomInterval<T>(true));
+    }
+    size_t k = n / 2;
+    y.Set(k, Interval<T>(T(-1), T(2)));
+    bool thrown = false;
+    try {
+        DIDivBatch(x, y, r);
+    } catch (const runtime_error &) {
+        thrown = true;
+    }
+    long bad = thrown ? 0 : 1;
+    for (size_t i = 0; i < n; i++) {
+        if (i == k)
+            continue;
+        Interval<T> s = DIDiv(x.Get(i), y.Get(i));
+        if (!same(s.a, r.a[i]) || !same(s.b, r.b[i]))
+            bad++;
+    }
+    return bad;
+}
+
+template<typename T>
+static long checkType(const char *type, size_t n) {
+    long total = 0;
+    for (IAMode mode : {PINT_MODE, DINT_MODE}) {
+        for (int op = 0; op < 4; op++) {
+            long bad = compare<T>(type, mode, op, n);
+            printf("%-12s %-5s %-6s %8zu par, niezgodności: %ld\n", type,
+                   mode == DINT_MODE ? "DINT" : "PINT", OP_NAMES[op], n, bad);
+            total += bad;
+        }
+        long bad = divisionByZero<T>(1000);
+        printf("%-12s %-5s %-6s dzielnik z zerem, niezgodności: %ld\n", type,
+               mode == DINT_MODE ? "DINT" : "PINT", "DIDiv", bad);
+        total += bad;
+    }
+    return total;
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? (size_t) atoll(argv[1]) : 100000;
+    Interval<float>::Initialize();
+    Interval<double>::Initialize();
+    Interval<long double>::Initialize();
+
+    long bad = checkType<float>("float", n)
+            + checkType<double>("double", n)
+            + checkType<long double>("long double", n);
+    printf("razem niezgodności: %ld\n", bad);
+    return bad != 0 ? 1 : 0;
+}
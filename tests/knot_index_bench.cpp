@@ -0,0 +1,210 @@
+/*
+ * knot_index_bench.cpp
+ *
+ * Sprawdzenie i pomiar wyszukiwania segmentu splajnu (KnotIndex, IntervalKnotIndex
+ * z main.cpp) względem dawnej liniowej pętli z evaluate().
+ *
+ * 1. Zgodność: dla węzłów losowych, równoodległych (ścieżka siatki równomiernej)
+ *    i leżących bliżej niż rozdzielczość double wynik segment() musi być taki sam
+ *    jak wynik dawnej pętli – dla zapytań w węzłach i tuż obok nich, poza zakresem
+ *    oraz losowych, punktowych i przedziałowych. Każda niezgodność kończy program
+ *    kodem 1.
+ * 2. Czas samego wyszukiwania (ns na zapytanie, losowe zapytania) dla liczby węzłów,
+ *    przy której indeks mieści się w L1, L2, L3 albo tylko w pamięci głównej
+ *    (około 28 B na węzeł: klucz __float128, double w drzewie i pozycja). Dawna
+ *    pętla jest mierzona na mniejszej liczbie zapytań, bo jej koszt rośnie z n.
+ *
+ * Budowanie i uruchomienie (z katalogu głównego repozytorium):
+ *   g++ -std=gnu++17 -O2 -I. tests/knot_index_bench.cpp -o knot_index_bench \
+ *       -lmpfr -lgmp -lquadmath -lpthread
+ *   ./knot_index_bench [liczba_węzłów_DRAM]
+ */
+
+#define main spline_main
+#include "../main.cpp"
+#undef main
+#include <random>
+#include <cstdio>
+
+namespace old_lookup {
+
+// Pętla z NaturalCubicSpline::evaluate sprzed KnotIndex
+int segment(const vector<__float128> &x, __float128 xi) {
+    int seg = 0;
+    if (xi < x[0])
+        seg = 0;
+    else if (xi >= x[x.size()-1])
+        seg = x.size()-2;
+    else {
+        for (int i = 0; i < x.size()-1; i++) {
+            if (xi >= x[i] && xi < x[i+1]) { seg = i; break; }
+        }
+    }
+    return seg;
+}
+
+// Pętla z NaturalCubicSplineInterval::evaluate sprzed IntervalKnotIndex
+int segment(const vector<Interval> &x, const Interval &xi) {
+    int seg = 0;
+    if(xi.lo < x[0].lo)
+        seg = 0;
+    else if(xi.hi >= x[x.size()-1].hi)
+        seg = x.size()-2;
+    else {
+        for (int i = 0; i < x.size()-1; i++) {
+            if(xi.lo >= x[i].lo && xi.hi < x[i+1].hi) { seg = i; break; }
+        }
+    }
+    return seg;
+}
+
+}
+
+static std::mt19937_64 rng(2024);
+
+static double uniform01() {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+}
+
+// Rosnące węzły: losowe odstępy (kind 0), równe odstępy (1) albo serie węzłów
+// różniących się mniej niż ulp double (2)
+static vector<__float128> makeKnots(size_t n, int kind) {
+    vector<__float128> x(n);
+    __float128 t = -0.5Q * (__float128) n;
+    for (size_t i = 0; i < n; i++) {
+        if (kind == 1)
+            x[i] = -0.5Q * (__float128) n + (__float128) i * 0.75Q;
+        else if (kind == 2 && i % 4 != 0)
+            x[i] = (t += 1e-20Q);
+        else
+            x[i] = (t += 0.01Q + (__float128) uniform01());
+    }
+    return x;
+}
+
+// Węzły przedziałowe [x[i], x[i] + r] z r mniejszym niż najmniejszy odstęp
+static vector<Interval> widen(const vector<__float128> &x) {
+    __float128 gap = 1.0Q;
+    for (size_t i = 1; i < x.size(); i++)
+        gap = fminq(gap, x[i] - x[i-1]);
+    vector<Interval> r(x.size());
+    for (size_t i = 0; i < x.size(); i++) {
+        r[i].lo = x[i];
+        r[i].hi = x[i] + gap / 3.0Q;
+    }
+    return r;
+}
+
+static int mismatches = 0;
+
+static void checkPoint(const vector<__float128> &x, const KnotIndex &index, __float128 q) {
+    if (index.segment(q) != old_lookup::segment(x, q))
+        mismatches++;
+}
+
+static void checkInterval(const vector<Interval> &x, const IntervalKnotIndex &index,
+                          __float128 lo, __float128 hi) {
+    if (lo > hi)
+        return;
+    Interval q = {lo, hi};
+    if (index.segment(q) != old_lookup::segment(x, q))
+        mismatches++;
+}
+
+static size_t verify(size_t n, int kind, size_t randomQueries) {
+    vector<__float128> x = makeKnots(n, kind);
+    vector<Interval> xi = widen(x);
+    KnotIndex index(x);
+    IntervalKnotIndex intervalIndex(xi);
+    size_t queries = 0;
+    // Zapytania w węzłach, tuż obok nich i poza zakresem
+    for (size_t i = 0; i < n; i++) {
+        for (__float128 q : {x[i], nextafterq(x[i], -INFINITY), nextafterq(x[i], INFINITY)}) {
+            checkPoint(x, index, q);
+            checkInterval(xi, intervalIndex, q, q);
+            checkInterval(xi, intervalIndex, q, xi[i].hi);
+            checkInterval(xi, intervalIndex, xi[i].lo, q);
+            queries += 4;
+        }
+        checkInterval(xi, intervalIndex, xi[i].lo, xi[i].hi);
+        checkInterval(xi, intervalIndex, xi[i].hi, xi[i].hi);
+        queries += 2;
+    }
+    for (__float128 q : {x[0] - 1.0Q, x[n-1] + 1.0Q, (__float128) -INFINITY, (__float128) INFINITY}) {
+        checkPoint(x, index, q);
+        checkInterval(xi, intervalIndex, q, q);
+        queries += 2;
+    }
+    // Losowe zapytania, także przedziały obejmujące kilka węzłów
+    __float128 span = x[n-1] - x[0];
+    for (size_t k = 0; k < randomQueries; k++) {
+        __float128 q = x[0] - 0.05Q * span + 1.1Q * span * (__float128) uniform01();
+        __float128 w = span * (__float128) (uniform01() * uniform01()) / (__float128) n;
+        checkPoint(x, index, q);
+        checkInterval(xi, intervalIndex, q, q + w);
+        queries += 2;
+    }
+    return queries;
+}
+
+// Czas na zapytanie w ns; suma segmentów trafia do sink, żeby pętla nie została usunięta
+template<typename F>
+static double timeLookups(size_t queries, F lookup, long &sink) {
+    auto t0 = chrono::steady_clock::now();
+    long s = 0;
+    for (size_t k = 0; k < queries; k++)
+        s += lookup(k);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    sink += s;
+    return seconds * 1e9 / (double) queries;
+}
+
+static void bench(const char *level, size_t n, long &sink) {
+    vector<__float128> x = makeKnots(n, 0);
+    vector<Interval> xi = widen(x);
+    KnotIndex index(x);
+    IntervalKnotIndex intervalIndex(xi);
+    const size_t QUERIES = 1 << 20;
+    vector<__float128> q(QUERIES);
+    vector<Interval> qi(QUERIES);
+    __float128 span = x[n-1] - x[0];
+    for (size_t k = 0; k < QUERIES; k++) {
+        q[k] = x[0] + span * (__float128) uniform01();
+        qi[k].lo = q[k];
+        qi[k].hi = q[k] + 1e-6Q;
+    }
+    // dawna pętla: około 2^28 porównań węzłów na pomiar
+    size_t oldQueries = max<size_t>(16, min<size_t>(QUERIES, (size_t(1) << 28) / n));
+
+    double tPoint = timeLookups(QUERIES, [&](size_t k) { return index.segment(q[k]); }, sink);
+    double tPointOld = timeLookups(oldQueries,
+            [&](size_t k) { return old_lookup::segment(x, q[k]); }, sink);
+    double tInterval = timeLookups(QUERIES,
+            [&](size_t k) { return intervalIndex.segment(qi[k]); }, sink);
+    double tIntervalOld = timeLookups(oldQueries,
+            [&](size_t k) { return old_lookup::segment(xi, qi[k]); }, sink);
+    printf("%-5s %9zu %9.1f MB %10.1f %12.1f %8.0fx %12.1f %12.1f %8.0fx\n", level, n,
+           (double) n * 28 / 1e6, tPoint, tPointOld, tPointOld / tPoint,
+           tInterval, tIntervalOld, tIntervalOld / tInterval);
+}
+
+int main(int argc, char **argv) {
+    size_t dramKnots = argc > 1 ? (size_t) atoll(argv[1]) : (size_t(1) << 23);
+
+    size_t checked = 0;
+    for (int kind = 0; kind < 3; kind++)
+        for (size_t n : {2, 3, 4, 5, 17, 100, 1000, 4096})
+            checked += verify(n, kind, 20000);
+    printf("zgodność z dawną pętlą: %zu zapytań, niezgodności: %d\n\n", checked, mismatches);
+
+    long sink = 0;
+    printf("ns na zapytanie (losowe zapytania, węzły o losowych odstępach)\n");
+    printf("%-5s %9s %12s %10s %12s %9s %12s %12s %9s\n", "", "węzły", "indeks",
+           "KnotIndex", "pętla", "zysk", "Interval*", "pętla", "zysk");
+    bench("L1", 1000, sink);
+    bench("L2", 1 << 15, sink);
+    bench("L3", 1 << 19, sink);
+    bench("DRAM", dramKnots, sink);
+    printf("(suma kontrolna %ld)\n", sink);
+    return mismatches != 0 ? 1 : 0;
+}